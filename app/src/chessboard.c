@@ -1,5 +1,8 @@
 #include "chessboard.h"
 #include "chessboard_calibration.h"
+#include "chessboard_stats.h"
+
+#include <string.h>
 
 #include <zephyr/kernel.h>
 
@@ -11,10 +14,6 @@
 
 LOG_MODULE_REGISTER(chessboard, LOG_LEVEL_INF);
 
-#define HAL_NUM_MEASUREMENTS            (uint8_t)1
-
-#define GET_INDEX(file, rank) ((rank) * 8 + (file))
-
 #define DT_SPEC_AND_COMMA(node_id, prop, idx) ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
 
 static const struct gpio_dt_spec channel_select_a =
@@ -45,10 +44,128 @@ static bool hal_sensor_inverted[8] = {
 static const struct adc_dt_spec adc_channels[] = {
 	DT_FOREACH_PROP_ELEM(DT_PATH(zephyr_user), io_channels, DT_SPEC_AND_COMMA)};
 
-static int32_t chess_pieces_mv[64] = {0};
+static int16_t chess_pieces_raw[CHESS_NUM_SQUARES] = {0};
+
+/* Millivolts at full scale and resolution of the ADC channels, all configured alike. Read from the
+ * devicetree by chessboard_init(), until then a 3.3 V full scale at 12 bits.
+ */
+static int32_t full_scale_mv = 3300;
+static uint8_t resolution_bits = 12;
+
+/* One precompiled ADC read: which mux code to select, which ADC input to sample and where the
+ * (optionally inverted) result ends up.
+ */
+struct scan_step {
+	uint8_t mux_code;
+	uint8_t adc_index;
+	uint8_t square;
+	bool inverted;
+};
+
+/* The SAM0 ADC has a single input mux, so switching ADC channel means a full channel setup while
+ * switching the external multiplexer is a GPIO write. The plan is therefore ordered file by file
+ * (one channel setup per file) and walks the multiplexer codes in Gray code order, reversed on
+ * every other file, so each step toggles at most one select line. Partial scans walk the same
+ * plan and skip the squares that were not requested, so they cost one channel setup per file
+ * touched and one multiplexer switch per square at most.
+ */
+static struct scan_step scan_plan[CHESS_NUM_SQUARES];
+static int16_t adc_sample;
+
+/* Channel configuration and read sequence of every ADC channel, per acquisition setting. The
+ * precise setting is the devicetree configuration; the fast one has the shortest acquisition
+ * time and no oversampling.
+ */
+static struct adc_channel_cfg channel_cfgs[CHESSBOARD_NUM_ACQUISITIONS][ARRAY_SIZE(adc_channels)];
+static struct adc_sequence adc_sequences[CHESSBOARD_NUM_ACQUISITIONS][ARRAY_SIZE(adc_channels)];
+static uint8_t acquisition = CHESSBOARD_ACQUISITION_PRECISE;
+/* Removed from every read with the fast setting, see chessboard_set_fast_bias() */
+static int16_t fast_bias_raw[CHESS_NUM_SQUARES];
+
+static bool scan_plan_ready;
+/* Scans completed successfully, see chessboard_get_scan_count() */
+static atomic_t scan_count = ATOMIC_INIT(0);
+static int active_adc_index = -1;
+static int active_multiplexer_channel = -1;
+
+/* Held for the whole duration of a scan, synchronous or asynchronous, as both drive the shared
+ * multiplexer select lines and ADC channel configuration. A semaphore rather than a mutex since
+ * asynchronous scans are released from the work queue.
+ */
+static K_SEM_DEFINE(scan_lock, 1, 1);
+
+/* Asynchronous scan state. One adc_read_async() covers all requested plan steps of one ADC
+ * channel; the ADC callback switches the multiplexer between the samples from interrupt context,
+ * and the work item only runs once per ADC channel to store the results and start the next one.
+ */
+static int16_t async_samples[CHESS_NUM_RANKS];
+static enum adc_action async_sample_done(const struct device *dev,
+					 const struct adc_sequence *sequence,
+					 uint16_t sampling_index);
+static struct adc_sequence_options async_options = {
+	.callback = async_sample_done,
+};
+static struct adc_sequence async_sequence;
+static struct k_poll_signal async_adc_signal;
+static struct k_poll_event async_adc_event;
+static struct k_work_poll async_work;
+static struct k_poll_signal *async_frame_signal;
+static int16_t *async_raw;
+static uint64_t async_mask;
+/* Plan index to continue collecting requested steps from */
+static int async_next_step;
+/* Plan indices of the steps in the running segment */
+static uint8_t async_steps[CHESS_NUM_RANKS];
+static int async_num_steps;
+static int async_error;
+/* Cycle counter when the ongoing conversion of the running segment started */
+static uint32_t async_conversion_start;
 
 static int select_multiplexer_channel(uint8_t channel);
-static int read_adc_channel(const int index, int32_t *val_mv, uint8_t num_measurements);
+static int prepare_scan_step(const struct scan_step *step);
+static void store_scan_step(const struct scan_step *step, int16_t raw);
+static int read_scan_step(const struct scan_step *step);
+static int collect_async_segment(void);
+static int start_async_segment(void);
+
+/* Scan the requested squares, with scan_lock held */
+static int scan_squares_locked(uint64_t mask)
+{
+	for (int i = 0; i < ARRAY_SIZE(scan_plan); i++) {
+		if ((mask & BIT64(scan_plan[i].square)) == 0) {
+			continue;
+		}
+
+		int ret = read_scan_step(&scan_plan[i]);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+	atomic_inc(&scan_count);
+	return 0;
+}
+
+/* Switch the acquisition setting, with scan_lock held */
+static void set_acquisition_locked(uint8_t new_acquisition)
+{
+	if (new_acquisition != acquisition) {
+		acquisition = new_acquisition;
+		/* Force a channel setup with the new configuration on the next read */
+		active_adc_index = -1;
+	}
+}
+
+int chessboard_scan_squares(uint64_t mask)
+{
+	if (!scan_plan_ready) {
+		return -ENODEV;
+	}
+
+	k_sem_take(&scan_lock, K_FOREVER);
+	int ret = scan_squares_locked(mask);
+	k_sem_give(&scan_lock);
+	return ret;
+}
 
 int chessboard_scan_file(uint8_t file)
 {
@@ -56,91 +173,138 @@ int chessboard_scan_file(uint8_t file)
 		return -EINVAL;
 	}
 
-	int32_t offset;
-	for (int multiplexer_channel = 0; multiplexer_channel < 8; multiplexer_channel++) {
-
-		int ret = select_multiplexer_channel(multiplexer_channel);
+	return chessboard_scan_squares(CHESS_FILE_MASK(file));
+}
 
-		if (ret != 0) {
-			LOG_ERR("Failed to select multiplexer channel %d: %d", multiplexer_channel,
-				ret);
-			return ret;
-		}
+int chessboard_scan(void)
+{
+	return chessboard_scan_squares(CHESS_ALL_SQUARES);
+}
 
-		int32_t val_mv;
-		ret = read_adc_channel(file, &val_mv, HAL_NUM_MEASUREMENTS);
-		if (ret < 0) {
-			LOG_ERR("Failed to read ADC channel %d (err %d)", file, ret);
-			return ret;
-		}
+int chessboard_scan_acquisition(uint8_t scan_acquisition, int16_t raw[CHESS_NUM_SQUARES])
+{
+	if (scan_acquisition >= CHESSBOARD_NUM_ACQUISITIONS) {
+		return -EINVAL;
+	}
 
-		if (hal_sensor_inverted[file]) {
-			val_mv = -val_mv;
-		}
+	if (!scan_plan_ready) {
+		return -ENODEV;
+	}
 
-		int rank = multiplexer_mapping[file][multiplexer_channel];
+	k_sem_take(&scan_lock, K_FOREVER);
+	const uint8_t previous = acquisition;
 
-		const int index = GET_INDEX(file, rank);
+	set_acquisition_locked(scan_acquisition);
+	int ret = scan_squares_locked(CHESS_ALL_SQUARES);
+	if (ret == 0) {
+		memcpy(raw, chess_pieces_raw, sizeof(chess_pieces_raw));
+	}
+	set_acquisition_locked(previous);
+	k_sem_give(&scan_lock);
+	return ret;
+}
 
-		chess_pieces_mv[index] = val_mv;
-		offset = chessboard_calibration_get_mv(file, rank) - val_mv;
+int chessboard_scan_precise(int16_t raw[CHESS_NUM_SQUARES])
+{
+	return chessboard_scan_acquisition(CHESSBOARD_ACQUISITION_PRECISE, raw);
+}
 
+void chessboard_set_fast_bias(const int16_t bias[CHESS_NUM_SQUARES])
+{
+	k_sem_take(&scan_lock, K_FOREVER);
+	memcpy(fast_bias_raw, bias, sizeof(fast_bias_raw));
+	k_sem_give(&scan_lock);
+}
 
-		if (ret != 0) {
-			LOG_ERR("Error reading square %02d: %d", index, ret);
-		}
-	}
-	return 0;
+void chessboard_get_fast_bias(int16_t bias[CHESS_NUM_SQUARES])
+{
+	k_sem_take(&scan_lock, K_FOREVER);
+	memcpy(bias, fast_bias_raw, sizeof(fast_bias_raw));
+	k_sem_give(&scan_lock);
 }
 
-int chessboard_scan(void)
+int chessboard_scan_async(uint64_t mask, int16_t raw[CHESS_NUM_SQUARES],
+			  struct k_poll_signal *done)
 {
-	int32_t offset;
-	for (int multiplexer_channel = 0; multiplexer_channel < 8; multiplexer_channel++) {
+	if (done == NULL || mask == 0) {
+		return -EINVAL;
+	}
 
-		int ret = select_multiplexer_channel(multiplexer_channel);
+	if (!scan_plan_ready) {
+		return -ENODEV;
+	}
 
-		if (ret != 0) {
-			LOG_ERR("Failed to select multiplexer channel %d: %d", multiplexer_channel,
-				ret);
-			return ret;
-		}
+	if (k_sem_take(&scan_lock, K_NO_WAIT) != 0) {
+		return -EBUSY;
+	}
 
-		for (int file = 0; file < 8; file++) {
+	async_frame_signal = done;
+	async_raw = raw;
+	async_mask = mask;
+	async_next_step = 0;
+	collect_async_segment();
 
-			int32_t val_mv;
-			ret = read_adc_channel(file, &val_mv, HAL_NUM_MEASUREMENTS);
-			if (ret < 0) {
-				LOG_ERR("Failed to read ADC channel %d (err %d)", file, ret);
-				return ret;
-			}
+	int ret = start_async_segment();
+	if (ret != 0) {
+		async_frame_signal = NULL;
+		k_sem_give(&scan_lock);
+	}
+	return ret;
+}
 
-			if (hal_sensor_inverted[file]) {
-				val_mv = -val_mv;
-			}
+bool chessboard_is_ready(void)
+{
+	return scan_plan_ready;
+}
 
-			int rank = multiplexer_mapping[file][multiplexer_channel];
+uint32_t chessboard_get_scan_count(void)
+{
+	return (uint32_t)atomic_get(&scan_count);
+}
 
-			const int index = GET_INDEX(file, rank);
+int chessboard_mux_to_square(uint8_t adc_index, uint8_t mux_code, bool *inverted)
+{
+	if (adc_index >= CHESS_NUM_FILES || mux_code >= CHESS_NUM_RANKS) {
+		return -EINVAL;
+	}
 
-			chess_pieces_mv[index] = val_mv;
-			offset = chessboard_calibration_get_mv(file, rank) - val_mv;
+	*inverted = hal_sensor_inverted[adc_index];
+	return CHESS_SQUARE(adc_index, multiplexer_mapping[adc_index][mux_code]);
+}
 
-			if (ret != 0) {
-				LOG_ERR("Error reading square %02d: %d", index, ret);
-			}
-		}
+int chessboard_set_acquisition(uint8_t new_acquisition)
+{
+	if (new_acquisition >= CHESSBOARD_NUM_ACQUISITIONS) {
+		return -EINVAL;
 	}
+
+	k_sem_take(&scan_lock, K_FOREVER);
+	set_acquisition_locked(new_acquisition);
+	k_sem_give(&scan_lock);
 	return 0;
 }
 
+uint8_t chessboard_get_acquisition(void)
+{
+	return acquisition;
+}
+
+int32_t chessboard_get_raw(uint8_t file, uint8_t rank)
+{
+	if (file > 7 || rank > 7) {
+		return -1;
+	}
+
+	return chess_pieces_raw[CHESS_SQUARE(file, rank)];
+}
+
 int32_t chessboard_get_mv(uint8_t file, uint8_t rank)
 {
 	if (file > 7 || rank > 7) {
 		return -1;
 	}
 
-	return chess_pieces_mv[GET_INDEX(file, rank)];
+	return chessboard_raw_to_mv(chess_pieces_raw[CHESS_SQUARE(file, rank)]);
 }
 
 int32_t chessboard_get_mv_offset(uint8_t file, uint8_t rank)
@@ -148,89 +312,352 @@ int32_t chessboard_get_mv_offset(uint8_t file, uint8_t rank)
 	if (file > 7 || rank > 7) {
 		return -1;
 	}
-	int index = GET_INDEX(file, rank);
-	return chessboard_calibration_get_mv(file, rank) - chess_pieces_mv[index];
+	int index = CHESS_SQUARE(file, rank);
+	return chessboard_raw_to_mv(chessboard_calibration_get_raw(file, rank) -
+				    chess_pieces_raw[index]);
+}
+
+void chessboard_copy_raw(int16_t raw[CHESS_NUM_SQUARES])
+{
+	k_sem_take(&scan_lock, K_FOREVER);
+	memcpy(raw, chess_pieces_raw, sizeof(chess_pieces_raw));
+	k_sem_give(&scan_lock);
+}
+
+/* Same arithmetic as adc_raw_to_millivolts_dt(), but rounding towards zero so inverted squares
+ * convert to the negated millivolts of the same count
+ */
+int32_t chessboard_raw_to_mv(int32_t raw)
+{
+	return (raw * full_scale_mv) / (int32_t)BIT(resolution_bits);
+}
+
+int32_t chessboard_mv_to_raw(int32_t mv)
+{
+	return (int32_t)(((int64_t)mv << resolution_bits) / full_scale_mv);
+}
+
+static const struct gpio_dt_spec *const channel_select[] = {&channel_select_a, &channel_select_b,
+							     &channel_select_c};
+
+/* An ADC driver call failed and the error was logged */
+static void count_adc_error(uint8_t adc_index)
+{
+	chessboard_stats_count_error(adc_index,
+				     CHESSBOARD_STATS_ERROR_ADC | CHESSBOARD_STATS_ERROR_LOGGED);
 }
 
 static int select_multiplexer_channel(uint8_t channel)
 {
+	const uint8_t changed = (active_multiplexer_channel < 0)
+					? 0x07
+					: (channel ^ (uint8_t)active_multiplexer_channel);
+
+	for (int i = 0; i < ARRAY_SIZE(channel_select); i++) {
+		if ((changed & BIT(i)) == 0) {
+			continue;
+		}
+
+		int ret = gpio_pin_set_dt(channel_select[i], (channel >> i) & 0x01);
+		if (ret < 0) {
+			active_multiplexer_channel = -1;
+			return ret;
+		}
+	}
+
+	active_multiplexer_channel = channel;
+	return 0;
+}
+
+static int prepare_scan_step(const struct scan_step *step)
+{
+	uint32_t start;
 	int ret;
-	const struct gpio_dt_spec *channels[] = {&channel_select_a, &channel_select_b,
-						 &channel_select_c};
-
-	static bool is_initialized = false;
-	if (!is_initialized) {
-		for (int i = 0; i < 3; i++) {
-			if (!gpio_is_ready_dt(channels[i])) {
-				return -ENODEV;
-			}
-			ret = gpio_pin_configure_dt(channels[i], GPIO_OUTPUT_INACTIVE);
-			if (ret < 0) {
-				return -ENODEV;
-			}
+
+	if (step->mux_code != active_multiplexer_channel) {
+		start = k_cycle_get_32();
+		ret = select_multiplexer_channel(step->mux_code);
+		chessboard_stats_add(CHESSBOARD_STATS_PHASE_MUX, start, 1);
+		if (ret != 0) {
+			LOG_ERR("Failed to select multiplexer channel %d: %d", step->mux_code, ret);
+			chessboard_stats_count_error(step->adc_index,
+						     CHESSBOARD_STATS_ERROR_LOGGED);
+			return ret;
 		}
-		is_initialized = true;
-		LOG_INF("Multiplexer channel select pins initialized\n");
 	}
 
-	for (int i = 0; i < 3; i++) {
-		int value = (channel >> i) & 0x01;
-		ret = gpio_pin_set_dt(channels[i], value);
+	if (step->adc_index != active_adc_index) {
+		start = k_cycle_get_32();
+		ret = adc_channel_setup(adc_channels[step->adc_index].dev,
+					&channel_cfgs[acquisition][step->adc_index]);
+		chessboard_stats_add(CHESSBOARD_STATS_PHASE_SETUP, start, 1);
 		if (ret < 0) {
+			LOG_ERR("Could not setup channel #%d (%d)", step->adc_index, ret);
+			count_adc_error(step->adc_index);
+			active_adc_index = -1;
 			return ret;
 		}
+		active_adc_index = step->adc_index;
 	}
 
 	return 0;
 }
 
-static int read_adc_channel(const int index, int32_t *val_mv, uint8_t num_measurements)
+static void store_scan_step(const struct scan_step *step, int16_t raw)
 {
-	if (index >= ARRAY_SIZE(adc_channels)) {
-		LOG_ERR("ADC channel index %d out of range", index);
-		return 0;
+	int16_t value = step->inverted ? -raw : raw;
+
+	if (acquisition == CHESSBOARD_ACQUISITION_FAST) {
+		value -= fast_bias_raw[step->square];
 	}
+	chess_pieces_raw[step->square] = value;
+}
 
-	struct adc_sequence sequence = {
-		.buffer = val_mv,
-		.buffer_size = sizeof(*val_mv),
-	};
+static int read_scan_step(const struct scan_step *step)
+{
+	int ret = prepare_scan_step(step);
+	if (ret != 0) {
+		return ret;
+	}
 
-	if (!adc_is_ready_dt(&adc_channels[index])) {
-		LOG_WRN("ADC controller device %s not ready\n", adc_channels[index].dev->name);
-		return 0;
+	uint32_t start = k_cycle_get_32();
+
+	ret = adc_read_dt(&adc_channels[step->adc_index],
+			  &adc_sequences[acquisition][step->adc_index]);
+	chessboard_stats_add(CHESSBOARD_STATS_PHASE_CONVERSION, start, 1);
+	if (ret != 0) {
+		LOG_ERR("Failed to read ADC channel %d (err %d)", step->adc_index, ret);
+		count_adc_error(step->adc_index);
+		return ret;
 	}
 
-	int ret = adc_channel_setup_dt(&adc_channels[index]);
-	if (ret < 0) {
-		LOG_ERR("Could not setup channel #%d (%d)\n", index, ret);
-		return 0;
+	start = k_cycle_get_32();
+	store_scan_step(step, adc_sample);
+	chessboard_stats_add(CHESSBOARD_STATS_PHASE_STORE, start, 1);
+	return 0;
+}
+
+/* Collect the next requested steps that share an ADC channel, returns the number of steps */
+static int collect_async_segment(void)
+{
+	async_num_steps = 0;
+
+	for (; async_next_step < ARRAY_SIZE(scan_plan); async_next_step++) {
+		const struct scan_step *step = &scan_plan[async_next_step];
+
+		if ((async_mask & BIT64(step->square)) == 0) {
+			continue;
+		}
+		if ((async_num_steps > 0) &&
+		    (step->adc_index != scan_plan[async_steps[0]].adc_index)) {
+			break;
+		}
+		async_steps[async_num_steps++] = async_next_step;
 	}
 
-	ret = adc_sequence_init_dt(&adc_channels[index], &sequence);
+	return async_num_steps;
+}
+
+static int start_async_segment(void)
+{
+	const struct scan_step *first = &scan_plan[async_steps[0]];
+
+	int ret = prepare_scan_step(first);
 	if (ret != 0) {
-		LOG_ERR("Could not init sequence for channel #%d (%d)\n", index, ret);
 		return ret;
 	}
 
-	*val_mv = 0;
+	async_error = 0;
+	async_options.extra_samplings = async_num_steps - 1;
+	async_sequence = adc_sequences[acquisition][first->adc_index];
+	async_sequence.options = &async_options;
+	async_sequence.buffer = async_samples;
+	async_sequence.buffer_size = async_num_steps * sizeof(async_samples[0]);
 
-	ret = adc_read_dt(&adc_channels[index], &sequence);
+	k_poll_signal_reset(&async_adc_signal);
+	async_adc_event.state = K_POLL_STATE_NOT_READY;
+	ret = k_work_poll_submit(&async_work, &async_adc_event, 1, K_FOREVER);
 	if (ret != 0) {
-		LOG_ERR("Failed to read ADC channel %d (err %d)", index, ret);
 		return ret;
 	}
 
-	return adc_raw_to_millivolts_dt(&adc_channels[index], val_mv);
+	async_conversion_start = k_cycle_get_32();
+	ret = adc_read_async(adc_channels[first->adc_index].dev, &async_sequence,
+			     &async_adc_signal);
+	if (ret != 0) {
+		LOG_ERR("Failed to start ADC channel %d (err %d)", first->adc_index, ret);
+		count_adc_error(first->adc_index);
+		k_work_poll_cancel(&async_work);
+	}
+	return ret;
+}
+
+/* Runs in interrupt context after every conversion of an asynchronous segment */
+static enum adc_action async_sample_done(const struct device *dev,
+					 const struct adc_sequence *sequence,
+					 uint16_t sampling_index)
+{
+	const int next = sampling_index + 1;
+
+	chessboard_stats_add(CHESSBOARD_STATS_PHASE_CONVERSION, async_conversion_start, 1);
+	if (next >= async_num_steps) {
+		return ADC_ACTION_FINISH;
+	}
+
+	const uint32_t start = k_cycle_get_32();
+	int ret = select_multiplexer_channel(scan_plan[async_steps[next]].mux_code);
+
+	chessboard_stats_add(CHESSBOARD_STATS_PHASE_MUX, start, 1);
+	if (ret != 0) {
+		async_error = ret;
+		return ADC_ACTION_FINISH;
+	}
+
+	async_conversion_start = k_cycle_get_32();
+	return ADC_ACTION_CONTINUE;
 }
 
-static int chessboard_setup()
+static void async_segment_done(struct k_work *work)
 {
-	int err = select_multiplexer_channel(0);
+	unsigned int signaled;
+	int result;
+
+	k_poll_signal_check(&async_adc_signal, &signaled, &result);
+	if (result != 0) {
+		chessboard_stats_count_error(scan_plan[async_steps[0]].adc_index,
+					     CHESSBOARD_STATS_ERROR_ADC);
+	} else {
+		result = async_error;
+	}
+
+	if (result == 0) {
+		const uint32_t start = k_cycle_get_32();
+
+		for (int i = 0; i < async_num_steps; i++) {
+			const struct scan_step *step = &scan_plan[async_steps[i]];
+
+			store_scan_step(step, async_samples[i]);
+			if (async_raw != NULL) {
+				async_raw[step->square] = chess_pieces_raw[step->square];
+			}
+		}
+		chessboard_stats_add(CHESSBOARD_STATS_PHASE_STORE, start, async_num_steps);
+	}
+
+	if (result == 0) {
+		if (collect_async_segment() > 0) {
+			result = start_async_segment();
+			if (result == 0) {
+				return;
+			}
+		}
+	} else {
+		LOG_ERR("Asynchronous scan failed at step %d (err %d)", async_steps[0], result);
+		chessboard_stats_count_error(scan_plan[async_steps[0]].adc_index,
+					     CHESSBOARD_STATS_ERROR_LOGGED);
+	}
+
+	if (result == 0) {
+		atomic_inc(&scan_count);
+	}
+
+	struct k_poll_signal *done = async_frame_signal;
+
+	async_frame_signal = NULL;
+	k_sem_give(&scan_lock);
+	k_poll_signal_raise(done, result);
+}
+
+/* Millivolts at full scale of the first channel, the conversion only matters for output */
+static void read_full_scale(void)
+{
+	int32_t mv = BIT(adc_channels[0].resolution);
+
+	int ret = adc_raw_to_millivolts_dt(&adc_channels[0], &mv);
+	if ((ret != 0) || (mv <= 0)) {
+		LOG_WRN("No millivolt conversion for channel #0 (%d), assuming %d mV at %u bits",
+			ret, full_scale_mv, resolution_bits);
+		return;
+	}
+
+	full_scale_mv = mv;
+	resolution_bits = adc_channels[0].resolution;
+}
+
+static int scan_plan_init(void)
+{
+	static const uint8_t gray_code[CHESS_NUM_RANKS] = {0, 1, 3, 2, 6, 7, 5, 4};
+	int step = 0;
+
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		if (!adc_is_ready_dt(&adc_channels[file])) {
+			LOG_ERR("ADC controller device %s not ready", adc_channels[file].dev->name);
+			return -ENODEV;
+		}
+
+		/* No channel setup here, the first read of every channel does it */
+		struct adc_sequence *precise = &adc_sequences[CHESSBOARD_ACQUISITION_PRECISE][file];
+		struct adc_sequence *fast = &adc_sequences[CHESSBOARD_ACQUISITION_FAST][file];
+
+		*precise = (struct adc_sequence){
+			.buffer = &adc_sample,
+			.buffer_size = sizeof(adc_sample),
+		};
+		int ret = adc_sequence_init_dt(&adc_channels[file], precise);
+		if (ret != 0) {
+			LOG_ERR("Could not init sequence for channel #%d (%d)", file, ret);
+			return ret;
+		}
+		*fast = *precise;
+		fast->oversampling = 0;
+
+		channel_cfgs[CHESSBOARD_ACQUISITION_PRECISE][file] = adc_channels[file].channel_cfg;
+		channel_cfgs[CHESSBOARD_ACQUISITION_FAST][file] = adc_channels[file].channel_cfg;
+		channel_cfgs[CHESSBOARD_ACQUISITION_FAST][file].acquisition_time =
+			ADC_ACQ_TIME_DEFAULT;
+
+		for (int i = 0; i < CHESS_NUM_RANKS; i++) {
+			const uint8_t mux_code = gray_code[(file & 1) ? (CHESS_NUM_RANKS - 1 - i) : i];
+			const uint8_t rank = multiplexer_mapping[file][mux_code];
+
+			scan_plan[step++] = (struct scan_step){
+				.mux_code = mux_code,
+				.adc_index = file,
+				.square = CHESS_SQUARE(file, rank),
+				.inverted = hal_sensor_inverted[file],
+			};
+		}
+	}
+
+	read_full_scale();
+
+	k_poll_signal_init(&async_adc_signal);
+	k_poll_event_init(&async_adc_event, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY,
+			  &async_adc_signal);
+	k_work_poll_init(&async_work, async_segment_done);
+
+	scan_plan_ready = true;
+	return 0;
+}
+
+int chessboard_init(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(channel_select); i++) {
+		if (!gpio_is_ready_dt(channel_select[i])) {
+			return -ENODEV;
+		}
+		int ret = gpio_pin_configure_dt(channel_select[i], GPIO_OUTPUT_INACTIVE);
+		if (ret < 0) {
+			return -ENODEV;
+		}
+	}
+	/* All select lines inactive, i.e. multiplexer channel 0 */
+	active_multiplexer_channel = 0;
+	LOG_INF("Multiplexer channel select pins initialized");
+
+	int err = scan_plan_init();
 	if (err != 0) {
-		LOG_ERR("Failed to setup chessboard multiplexer: %d", err);
+		LOG_ERR("Failed to prepare chessboard scan plan: %d", err);
 	}
 	return err;
 }
-
-SYS_INIT(chessboard_setup, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
+struct k_poll_signal;
+
 #define CHESS_FILE_A    ((uint8_t)0u)
 #define CHESS_FILE_B    ((uint8_t)1u)
 #define CHESS_FILE_C    ((uint8_t)2u)
@@ -22,8 +25,104 @@
 #define CHESS_RANK_8    ((uint8_t)7u)
 #define CHESS_NUM_RANKS ((uint8_t)8u)
 
+#define CHESS_NUM_SQUARES (CHESS_NUM_FILES * CHESS_NUM_RANKS)
+
+/* Index of a square in a 64 entry board array, A1 = 0, B1 = 1, ..., H8 = 63 */
+#define CHESS_SQUARE(file, rank) ((rank) * CHESS_NUM_FILES + (file))
+
+/* Mask of all squares of a file, bit n is CHESS_SQUARE() n */
+#define CHESS_FILE_MASK(file) (0x0101010101010101ull << (file))
+#define CHESS_ALL_SQUARES     (~0ull)
+
+/* Configure the multiplexer select pins and prepare the scan plan, called once at boot */
+int chessboard_init(void);
+
+/**
+ * Scan only the requested squares, the others keep their previous value. Only the ADC channels
+ * and multiplexer codes of the requested squares are visited, so checking a few squares costs a
+ * few conversions rather than a full frame.
+ *
+ * @param mask Squares to scan, bit n is CHESS_SQUARE() n.
+ */
+int chessboard_scan_squares(uint64_t mask);
 int chessboard_scan_file(uint8_t file);
 int chessboard_scan(void);
+
+/**
+ * Square wired to multiplexer input @p mux_code of ADC channel @p adc_index, used by the board
+ * model of the native_sim build.
+ *
+ * @param inverted Set if the sensors of that channel are mounted inverted.
+ *
+ * @return CHESS_SQUARE() index, or -EINVAL.
+ */
+int chessboard_mux_to_square(uint8_t adc_index, uint8_t mux_code, bool *inverted);
+
+/* Devicetree acquisition time and oversampling */
+#define CHESSBOARD_ACQUISITION_PRECISE ((uint8_t)0u)
+/* Shortest acquisition time and no oversampling, noisier but many times faster */
+#define CHESSBOARD_ACQUISITION_FAST    ((uint8_t)1u)
+#define CHESSBOARD_NUM_ACQUISITIONS    2
+
+/* Select the acquisition setting of all following scans, waits for a scan in progress */
+int chessboard_set_acquisition(uint8_t acquisition);
+uint8_t chessboard_get_acquisition(void);
+
+/**
+ * Scan all squares with @p acquisition, whichever setting the background scans currently use,
+ * and copy the raw counts. The values are not filtered.
+ *
+ * @return 0 on success, -EINVAL for an unknown setting, or the error of the scan.
+ */
+int chessboard_scan_acquisition(uint8_t acquisition, int16_t raw[CHESS_NUM_SQUARES]);
+int chessboard_scan_precise(int16_t raw[CHESS_NUM_SQUARES]);
+
+/**
+ * Raw counts the fast setting reads above the precise one, per square in CHESS_SQUARE() order.
+ * Subtracted from every fast read, so readings of both settings share the calibration offsets
+ * and the filter history. All zero until measured by chessboard_calibration_measure_fast().
+ */
+void chessboard_set_fast_bias(const int16_t bias[CHESS_NUM_SQUARES]);
+void chessboard_get_fast_bias(int16_t bias[CHESS_NUM_SQUARES]);
+
+/**
+ * Start an interrupt driven scan and return immediately. Squares outside the mask keep their
+ * previous value.
+ *
+ * @param mask Squares to scan, bit n is CHESS_SQUARE() n.
+ * @param raw  If not NULL, receives the raw counts of the squares in @p mask before the scan lock
+ *             is released, so a scan that starts right after cannot overwrite them. The other
+ *             squares are left untouched.
+ * @param done Raised with 0 once all requested squares are acquired, or with a negative error
+ *             code.
+ *
+ * @return 0 if the scan was started, -EBUSY if another scan is in progress.
+ */
+int chessboard_scan_async(uint64_t mask, int16_t raw[CHESS_NUM_SQUARES],
+			  struct k_poll_signal *done);
+
+/* Whether chessboard_init() prepared the scan plan, every scan fails with -ENODEV otherwise */
+bool chessboard_is_ready(void);
+
+/* Scans completed successfully since boot, synchronous or asynchronous, whoever ran them */
+uint32_t chessboard_get_scan_count(void);
 int chessboard_calibrate(void);
+
+/*
+ * Squares are acquired and processed as raw ADC counts, negated for the sensors mounted inverted,
+ * so offsets and thresholds are plain integer subtractions. Millivolts are only computed for
+ * output.
+ */
+int32_t chessboard_get_raw(uint8_t file, uint8_t rank);
 int32_t chessboard_get_mv(uint8_t file, uint8_t rank);
 int32_t chessboard_get_mv_offset(uint8_t file, uint8_t rank);
+
+/**
+ * Copy the most recently acquired raw counts of every square, waiting for a scan in progress to
+ * complete first so the copy is never a mix of two scans.
+ */
+void chessboard_copy_raw(int16_t raw[CHESS_NUM_SQUARES]);
+
+/* Convert raw counts, or a difference of raw counts, to millivolts and back */
+int32_t chessboard_raw_to_mv(int32_t raw);
+int32_t chessboard_mv_to_raw(int32_t mv);
@@ -0,0 +1,80 @@
+#include "chessboard_boot.h"
+#include "chessboard.h"
+#include "chessboard_calibration.h"
+#include "watchdog.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/hwinfo.h>
+#include <zephyr/init.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(chessboard_boot, LOG_LEVEL_INF);
+
+static struct k_spinlock boot_lock;
+static atomic_t reached;
+static struct chessboard_boot_info boot_info;
+
+void chessboard_boot_mark(uint8_t phase)
+{
+	/* Cheap enough to be called for every frame */
+	if (phase >= CHESSBOARD_BOOT_NUM_PHASES || atomic_test_bit(&reached, phase)) {
+		return;
+	}
+
+	const uint32_t now_us = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+
+	K_SPINLOCK(&boot_lock) {
+		if (!atomic_test_bit(&reached, phase)) {
+			boot_info.phase_us[phase] = now_us;
+			boot_info.reached |= BIT(phase);
+			atomic_set_bit(&reached, phase);
+		}
+	}
+}
+
+void chessboard_boot_get_info(struct chessboard_boot_info *info)
+{
+	K_SPINLOCK(&boot_lock) {
+		*info = boot_info;
+	}
+}
+
+/*
+ * The whole boot sequence of the application in one place, so the order is explicit and every
+ * step runs once: arm the watchdog, prepare the multiplexer and the scan plan, then load the
+ * calibration. The scanner thread starts right after the init levels, the first frame does not
+ * wait for the console or anything else.
+ */
+static int chessboard_boot(void)
+{
+	uint32_t cause = 0;
+
+	if (hwinfo_get_reset_cause(&cause) == 0) {
+		hwinfo_clear_reset_cause();
+	}
+	boot_info.reset_cause = cause;
+
+	int ret = watchdog_init();
+	if (IS_ENABLED(CONFIG_TASK_WDT) && ret == 0) {
+		chessboard_boot_mark(CHESSBOARD_BOOT_WATCHDOG);
+	}
+
+	int err = chessboard_init();
+	if (err != 0) {
+		return err;
+	}
+	chessboard_boot_mark(CHESSBOARD_BOOT_SCAN_READY);
+
+	err = chessboard_calibration_init();
+	if (err != 0) {
+		return err;
+	}
+	chessboard_boot_mark(CHESSBOARD_BOOT_CALIBRATION);
+
+	LOG_INF("Ready to scan after %u us, reset cause 0x%08x",
+		boot_info.phase_us[CHESSBOARD_BOOT_CALIBRATION], cause);
+	return ret;
+}
+
+SYS_INIT(chessboard_boot, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
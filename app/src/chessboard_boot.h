@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Boot phases, in the order they are normally reached. Each one is timestamped the first time it
+ * is reached, in microseconds of uptime.
+ */
+/* The watchdog is armed */
+#define CHESSBOARD_BOOT_WATCHDOG     ((uint8_t)0u)
+/* Multiplexer select pins and scan plan prepared */
+#define CHESSBOARD_BOOT_SCAN_READY   ((uint8_t)1u)
+/* Calibration loaded and thresholds applied */
+#define CHESSBOARD_BOOT_CALIBRATION  ((uint8_t)2u)
+/* The scanner thread started */
+#define CHESSBOARD_BOOT_SCANNER      ((uint8_t)3u)
+/* First frame published and run through the detection engine */
+#define CHESSBOARD_BOOT_FIRST_FRAME  ((uint8_t)4u)
+/* Game tracking resumed the game interrupted by a warm reset */
+#define CHESSBOARD_BOOT_GAME_RESUMED ((uint8_t)5u)
+/* Game tracking found the start position */
+#define CHESSBOARD_BOOT_GAME_STARTED ((uint8_t)6u)
+/* A host opened the console */
+#define CHESSBOARD_BOOT_CONSOLE      ((uint8_t)7u)
+#define CHESSBOARD_BOOT_NUM_PHASES   8
+
+struct chessboard_boot_info {
+	/* RESET_* flags of the hwinfo API, 0 if the reset cause is not available */
+	uint32_t reset_cause;
+	/* Phases reached so far, bit n is phase n */
+	uint8_t reached;
+	uint32_t phase_us[CHESSBOARD_BOOT_NUM_PHASES];
+};
+
+/* Record that a boot phase was reached, only the first call per phase counts */
+void chessboard_boot_mark(uint8_t phase);
+void chessboard_boot_get_info(struct chessboard_boot_info *info);
@@ -1,89 +1,650 @@
-
 #include <zephyr/kernel.h>
 #include <zephyr/settings/settings.h>
 #include "chessboard.h"
+#include "chessboard_calibration.h"
+#include "chessboard_detect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(chessboard_calibration, LOG_LEVEL_INF);
 
-static int16_t calibration_offset_mv[8][8] = {
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
-	{1650, 1650, 1650, 1650, 1650, 1650, 1650, 1650},
+/* Pause between two calibration scans, so the background scans keep going in between */
+#define CALIBRATION_SCAN_INTERVAL_MS 10
+
+/* Per square thresholds are this many standard deviations of the square's noise away from its
+ * mean, with the hysteresis scaled the same way, but never below the minimums. The minimums are
+ * converted to raw counts when the thresholds are applied.
+ */
+#define CALIBRATION_THRESHOLD_SIGMAS   6
+#define CALIBRATION_HYSTERESIS_SIGMAS  2
+#define CALIBRATION_MIN_THRESHOLD_MV   20
+#define CALIBRATION_MIN_HYSTERESIS_MV  5
+/* A square this noisy most likely has a faulty sensor */
+#define CALIBRATION_NOISY_THRESHOLD_MV 100
+
+/* A fast read of a square is confirmed with the precise setting within this many standard
+ * deviations of its difference to a precise read, at least one count. Until the fast setting is
+ * measured the default applies, about 20 mV with a 3.3 V full scale at 12 bits.
+ */
+#define CALIBRATION_CONFIRM_SIGMAS             4
+#define CALIBRATION_DEFAULT_CONFIRM_MARGIN_RAW 25
+
+/* Records are written from a work queue of their own: a flash erase can take tens of milliseconds
+ * and the system work queue completes the asynchronous scans.
+ */
+#define CALIBRATION_WQ_STACK_SIZE 1536
+#define CALIBRATION_WQ_PRIORITY   13
+/* Delay before retrying a failed write */
+#define CALIBRATION_RETRY_MS      5000
+
+/* A file is only written again when a square moved by more than the uncertainty of two
+ * calibrations of N frames since its stored one, so calibrating an unchanged board does not wear
+ * the flash. Two means of the same square differ by sigma * sqrt(2 / N) and two standard
+ * deviations by about sigma / sqrt(N - 1), a change of more than this many of those is real. The
+ * offset also tolerates a count of rounding. Within the tolerance the stored values are kept.
+ */
+#define CALIBRATION_CHANGE_SIGMAS        3
+#define CALIBRATION_OFFSET_TOLERANCE_RAW 1
+
+#define ALL_FILES ((uint8_t)0xFFu)
+
+/* Calibration of one file, stored under calibration/file/<a-h>. Version 1 records held the offsets
+ * in millivolts and the noise in microvolts, they are converted at boot and written again.
+ */
+#define CALIBRATION_RECORD_VERSION    2
+#define CALIBRATION_RECORD_VERSION_MV 1
+/* noise_q8 holds measured values */
+#define CALIBRATION_RECORD_NOISE      BIT(0)
+
+struct calibration_record {
+	uint8_t version;
+	uint8_t file;
+	uint8_t flags;
+	uint8_t reserved;
+	int16_t offset_raw[CHESS_NUM_RANKS];
+	uint16_t noise_q8[CHESS_NUM_RANKS];
+} __packed;
+
+/* Keys of the single blobs written by older firmware, migrated to records at boot */
+#define CALIBRATION_LEGACY_OFFSET_KEY "calibration/calibration"
+#define CALIBRATION_LEGACY_NOISE_KEY  "calibration/noise"
+
+/* Raw counts of the empty squares, indexed [rank][file] so the table is in CHESS_SQUARE() order.
+ * Mid-scale until calibrated.
+ */
+static int16_t calibration_offset_raw[8][8] = {
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
+	{2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048},
 };
 
+/* Standard deviation of every square in 1/256 raw counts, only meaningful for the files in
+ * noise_files. Calibration data saved by older firmware has no noise, the default thresholds apply
+ * then.
+ */
+static uint16_t calibration_noise_q8[8][8];
+static uint8_t noise_files;
+
+/* Streaming mean and variance of a square (Welford): mean in 1/256 counts and sum of squared
+ * differences from the mean in 1/65536 counts^2
+ */
+struct square_moments {
+	int32_t mean_q8;
+	int64_t m2_q16;
+};
+
+/* Confirm margin of every square in raw counts, each entry replaced as a whole */
+static uint16_t confirm_margin_raw[CHESS_NUM_SQUARES] = {
+	[0 ... CHESS_NUM_SQUARES - 1] = CALIBRATION_DEFAULT_CONFIRM_MARGIN_RAW,
+};
+
+/* Only used with calibration_lock held */
+static K_MUTEX_DEFINE(calibration_lock);
+static struct square_moments moments[CHESS_NUM_SQUARES];
+static int16_t scan_raw[CHESS_NUM_SQUARES];
+static int16_t fast_raw[CHESS_NUM_SQUARES];
+static int16_t fast_bias_raw[CHESS_NUM_SQUARES];
+static bool fast_measured;
+static struct chessboard_thresholds square_thresholds[CHESS_NUM_SQUARES];
+/* Files whose record differs from the stored one, bit n is file n */
+static uint8_t pending_files;
+/* Set while the legacy blobs still have to be deleted */
+static bool legacy_stored;
+static struct chessboard_calibration_status save_status;
+
+/* Only used while loading, before the work queue runs, bit n is file n */
+static uint8_t loaded_record_files;
+static uint8_t loaded_legacy_files;
+/* Files loaded from version 1 records, written again in the current version */
+static uint8_t converted_files;
+
+static K_THREAD_STACK_DEFINE(calibration_wq_stack, CALIBRATION_WQ_STACK_SIZE);
+static struct k_work_q calibration_wq;
+static void save_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(save_work, save_work_handler);
+
 static int chessboard_calibration_set(const char *name, size_t len, settings_read_cb read_cb,
 				      void *cb_arg);
+static int chessboard_calibration_commit(void);
 
-struct settings_handler chessboard_calibration_setting = {.name = "calibration",
-							  .h_set = chessboard_calibration_set};
+struct settings_handler chessboard_calibration_setting = {
+	.name = "calibration",
+	.h_set = chessboard_calibration_set,
+	.h_commit = chessboard_calibration_commit,
+};
+
+int32_t chessboard_calibration_get_raw(uint8_t file, uint8_t rank)
+{
+	if (file > 7 || rank > 7) {
+		return -1;
+	}
+	return (int32_t)calibration_offset_raw[rank][file];
+}
 
 int32_t chessboard_calibration_get_mv(uint8_t file, uint8_t rank)
 {
 	if (file > 7 || rank > 7) {
 		return -1;
 	}
-	return (int32_t)calibration_offset_mv[rank][file];
+	return chessboard_raw_to_mv(calibration_offset_raw[rank][file]);
+}
+
+const int16_t *chessboard_calibration_get_offsets(void)
+{
+	return &calibration_offset_raw[0][0];
+}
+
+const uint16_t *chessboard_calibration_get_confirm_margins(void)
+{
+	return confirm_margin_raw;
+}
+
+int32_t chessboard_calibration_get_noise_uv(uint8_t file, uint8_t rank)
+{
+	if (file > 7 || rank > 7 || !(noise_files & BIT(file))) {
+		return -1;
+	}
+	/* In 1/1000 counts, so the conversion yields microvolts */
+	return chessboard_raw_to_mv(
+		DIV_ROUND_CLOSEST((int32_t)calibration_noise_q8[rank][file] * 1000, 256));
+}
+
+/* Noise of a version 1 record or a legacy blob, in microvolts, to 1/256 raw counts */
+static uint16_t noise_uv_to_q8(uint16_t noise_uv)
+{
+	const int32_t noise_q8 = chessboard_mv_to_raw(DIV_ROUND_CLOSEST(noise_uv * 256, 1000));
+
+	return (uint16_t)CLAMP(noise_q8, 0, UINT16_MAX);
+}
+
+static uint32_t isqrt64(uint64_t value)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1ull << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)root;
 }
 
-int chessboard_calibration_calibrate(void)
+/* Add sample number n, counting from 1, of a square */
+static void moments_add(struct square_moments *m, int32_t n, int32_t raw)
 {
-	int ret = chessboard_scan();
+	const int32_t x_q8 = raw * 256;
+	const int32_t delta = x_q8 - m->mean_q8;
 
+	m->mean_q8 += delta / n;
+	/* Both factors have the sign of delta, so the sum never goes negative */
+	m->m2_q16 += (int64_t)delta * (x_q8 - m->mean_q8);
+}
+
+/* Mean and standard deviation of the n samples of a square */
+static void moments_result(const struct square_moments *m, int32_t n, int16_t *offset_raw,
+			   uint16_t *noise_q8)
+{
+	const uint64_t variance_q16 = (uint64_t)m->m2_q16 / (n - 1);
+
+	*offset_raw = (int16_t)DIV_ROUND_CLOSEST(m->mean_q8, 256);
+	*noise_q8 = (uint16_t)MIN(isqrt64(variance_q16), UINT16_MAX);
+}
+
+/* Whether a new calibration of a square from @p frames frames differs from the current one beyond
+ * the tolerances. Compared squared, no square root needed.
+ */
+static bool square_changed(int16_t offset_raw, uint16_t noise_q8, int16_t new_offset_raw,
+			   uint16_t new_noise_q8, int32_t frames)
+{
+	const uint64_t sigma_q8 = MAX(noise_q8, new_noise_q8);
+	const uint64_t limit_q16 = CALIBRATION_CHANGE_SIGMAS * CALIBRATION_CHANGE_SIGMAS *
+				   sigma_q8 * sigma_q8;
+	const uint64_t offset_delta_q8 = (uint64_t)abs(new_offset_raw - offset_raw) * 256;
+	const uint64_t noise_delta_q8 = abs((int32_t)new_noise_q8 - (int32_t)noise_q8);
+
+	if ((offset_delta_q8 > CALIBRATION_OFFSET_TOLERANCE_RAW * 256) &&
+	    (offset_delta_q8 * offset_delta_q8 * frames > 2 * limit_q16)) {
+		return true;
+	}
+	return noise_delta_q8 * noise_delta_q8 * (frames - 1) > limit_q16;
+}
+
+/* Confirm margin of a square whose fast reads differ from the precise ones by @p noise_q8 */
+static uint16_t confirm_margin(uint16_t noise_q8)
+{
+	return (uint16_t)MAX(1, DIV_ROUND_UP(CALIBRATION_CONFIRM_SIGMAS * (uint32_t)noise_q8, 256));
+}
+
+/* Derive the thresholds of every square from its noise, with calibration_lock held */
+static int apply_thresholds_locked(void)
+{
+	if (noise_files != ALL_FILES) {
+		return -ENODATA;
+	}
+
+	const int32_t min_threshold = chessboard_mv_to_raw(CALIBRATION_MIN_THRESHOLD_MV);
+	const int32_t min_hysteresis = chessboard_mv_to_raw(CALIBRATION_MIN_HYSTERESIS_MV);
+	const int32_t noisy_threshold = chessboard_mv_to_raw(CALIBRATION_NOISY_THRESHOLD_MV);
+
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		const uint8_t file = square % CHESS_NUM_FILES;
+		const uint8_t rank = square / CHESS_NUM_FILES;
+		const uint32_t noise_q8 = calibration_noise_q8[rank][file];
+		const int16_t threshold =
+			MAX(min_threshold,
+			    DIV_ROUND_UP(CALIBRATION_THRESHOLD_SIGMAS * noise_q8, 256));
+		const uint16_t hysteresis =
+			MAX(min_hysteresis,
+			    DIV_ROUND_UP(CALIBRATION_HYSTERESIS_SIGMAS * noise_q8, 256));
+
+		if (threshold > noisy_threshold) {
+			LOG_WRN("Square %c%d is noisy, threshold %d mV", 'A' + file, rank + 1,
+				chessboard_raw_to_mv(threshold));
+		}
+
+		square_thresholds[square] = (struct chessboard_thresholds){
+			.negative_raw = -threshold,
+			.positive_raw = threshold,
+			.hysteresis_raw = hysteresis,
+		};
+	}
+
+	return chessboard_detect_set_square_thresholds(square_thresholds);
+}
+
+int chessboard_calibration_apply_thresholds(void)
+{
+	k_mutex_lock(&calibration_lock, K_FOREVER);
+	int ret = apply_thresholds_locked();
+	k_mutex_unlock(&calibration_lock);
+	return ret;
+}
+
+/* Acquire the scans and accumulate the moments of every square, with calibration_lock held */
+static int measure_locked(uint16_t frames)
+{
+	memset(moments, 0, sizeof(moments));
+
+	for (int32_t n = 1; n <= frames; n++) {
+		int ret = chessboard_scan_precise(scan_raw);
+		if (ret != 0) {
+			return ret;
+		}
+
+		for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+			moments_add(&moments[square], n, scan_raw[square]);
+		}
+
+		k_msleep(CALIBRATION_SCAN_INTERVAL_MS);
+	}
+
+	return 0;
+}
+
+/* Measure the fast setting against the precise one, with calibration_lock held. The pieces
+ * and any drift are the same in both reads of a pair, so only the difference of the settings
+ * remains. The reads already have the current bias removed, so the mean is a correction to it.
+ */
+static int measure_fast_locked(uint16_t frames)
+{
+	memset(moments, 0, sizeof(moments));
+
+	for (int32_t n = 1; n <= frames; n++) {
+		int ret = chessboard_scan_precise(scan_raw);
+		if (ret == 0) {
+			ret = chessboard_scan_acquisition(CHESSBOARD_ACQUISITION_FAST, fast_raw);
+		}
+		if (ret != 0) {
+			return ret;
+		}
+
+		for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+			moments_add(&moments[square], n, fast_raw[square] - scan_raw[square]);
+		}
+
+		k_msleep(CALIBRATION_SCAN_INTERVAL_MS);
+	}
+
+	uint16_t max_margin = 0;
+
+	chessboard_get_fast_bias(fast_bias_raw);
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		int16_t bias_raw;
+		uint16_t noise_q8;
+
+		moments_result(&moments[square], frames, &bias_raw, &noise_q8);
+		fast_bias_raw[square] += bias_raw;
+		confirm_margin_raw[square] = confirm_margin(noise_q8);
+		max_margin = MAX(max_margin, confirm_margin_raw[square]);
+	}
+	chessboard_set_fast_bias(fast_bias_raw);
+	fast_measured = true;
+
+	LOG_INF("Measured the fast setting from %u scans, confirm margin up to %u counts", frames,
+		max_margin);
+	return 0;
+}
+
+int chessboard_calibration_measure_fast(uint16_t frames)
+{
+	if ((frames < CHESSBOARD_CALIBRATION_MIN_FRAMES) ||
+	    (frames > CHESSBOARD_CALIBRATION_MAX_FRAMES)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&calibration_lock, K_FOREVER);
+	int ret = measure_fast_locked(frames);
+	k_mutex_unlock(&calibration_lock);
+	return ret;
+}
+
+int chessboard_calibration_calibrate(uint16_t frames)
+{
+	if ((frames < CHESSBOARD_CALIBRATION_MIN_FRAMES) ||
+	    (frames > CHESSBOARD_CALIBRATION_MAX_FRAMES)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&calibration_lock, K_FOREVER);
+
+	int ret = measure_locked(frames);
 	if (ret != 0) {
+		k_mutex_unlock(&calibration_lock);
 		return ret;
 	}
-	int32_t mv;
-	for (int rank = 0; rank < 8; rank++) {
-		for (int file = 0; file < 8; file++) {
-			mv = chessboard_get_mv(file, rank);
-			if (mv < INT16_MIN) {
-				LOG_ERR("mv reading %d below int16 min at file %d, rank %d", mv,
-					file, rank);
-				return -EOVERFLOW;
-			}
 
-			if (mv > INT16_MAX) {
-				LOG_ERR("mv reading %d exceeds int16 max at file %d, rank %d", mv,
-					file, rank);
-				return -EOVERFLOW;
-			}
+	uint8_t changed = ~noise_files;
+
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		const uint8_t file = square % CHESS_NUM_FILES;
+		const uint8_t rank = square / CHESS_NUM_FILES;
+		int16_t offset_raw;
+		uint16_t noise_q8;
 
-			calibration_offset_mv[rank][file] = (int16_t)mv;
+		moments_result(&moments[square], frames, &offset_raw, &noise_q8);
+		if (square_changed(calibration_offset_raw[rank][file],
+				   calibration_noise_q8[rank][file], offset_raw, noise_q8,
+				   frames)) {
+			changed |= BIT(file);
 		}
 	}
 
-	ret = settings_save_one("calibration/calibration", &calibration_offset_mv,
-				sizeof(calibration_offset_mv));
+	/* Unchanged files keep their stored values, so a slow drift is still written once it adds
+	 * up beyond the tolerance
+	 */
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		const uint8_t file = square % CHESS_NUM_FILES;
+		const uint8_t rank = square / CHESS_NUM_FILES;
+
+		if (changed & BIT(file)) {
+			moments_result(&moments[square], frames,
+				       &calibration_offset_raw[rank][file],
+				       &calibration_noise_q8[rank][file]);
+		}
+	}
+	noise_files = ALL_FILES;
 
+	ret = apply_thresholds_locked();
 	if (ret != 0) {
-		LOG_ERR("Failed to save calibration data: %d", ret);
-	} else {
-		LOG_INF("Calibration data saved successfully");
+		LOG_ERR("Failed to apply the calibrated thresholds: %d", ret);
+	}
+
+	pending_files |= changed;
+	save_status.unchanged += CHESS_NUM_FILES - POPCOUNT(changed);
+	if (pending_files != 0) {
+		k_work_reschedule_for_queue(&calibration_wq, &save_work, K_NO_WAIT);
 	}
+	LOG_INF("Calibrated from %u scans, %d of %d files changed", frames, POPCOUNT(changed),
+		CHESS_NUM_FILES);
 
+	k_mutex_unlock(&calibration_lock);
 	return ret;
 }
 
+void chessboard_calibration_get_status(struct chessboard_calibration_status *status)
+{
+	k_mutex_lock(&calibration_lock, K_FOREVER);
+	*status = save_status;
+	status->pending_files = pending_files;
+	status->noise_files = noise_files;
+	status->legacy_stored = legacy_stored;
+	status->fast_measured = fast_measured;
+	k_mutex_unlock(&calibration_lock);
+}
+
+static void record_key(char *key, size_t size, uint8_t file)
+{
+	snprintf(key, size, "calibration/file/%c", 'a' + file);
+}
+
+/* Write the pending records one by one, the calibration can change in between */
+static void save_work_handler(struct k_work *work)
+{
+	struct calibration_record record;
+	char key[sizeof("calibration/file/a")];
+	int ret = 0;
+
+	while (ret == 0) {
+		k_mutex_lock(&calibration_lock, K_FOREVER);
+		if (pending_files == 0) {
+			k_mutex_unlock(&calibration_lock);
+			break;
+		}
+
+		const uint8_t file = (uint8_t)__builtin_ctz(pending_files);
+
+		pending_files &= ~BIT(file);
+		record = (struct calibration_record){
+			.version = CALIBRATION_RECORD_VERSION,
+			.file = file,
+			.flags = (noise_files & BIT(file)) ? CALIBRATION_RECORD_NOISE : 0,
+		};
+		for (uint8_t rank = 0; rank < CHESS_NUM_RANKS; rank++) {
+			record.offset_raw[rank] = calibration_offset_raw[rank][file];
+			record.noise_q8[rank] = calibration_noise_q8[rank][file];
+		}
+		save_status.busy = true;
+		k_mutex_unlock(&calibration_lock);
+
+		record_key(key, sizeof(key), file);
+		ret = settings_save_one(key, &record, sizeof(record));
+
+		k_mutex_lock(&calibration_lock, K_FOREVER);
+		save_status.busy = false;
+		if (ret == 0) {
+			save_status.written++;
+		} else {
+			/* Retried later, unless a new calibration comes first */
+			pending_files |= BIT(file);
+			save_status.failed++;
+			save_status.last_error = ret;
+		}
+		k_mutex_unlock(&calibration_lock);
+	}
+
+	if (ret != 0) {
+		LOG_ERR("Failed to save calibration record: %d", ret);
+		k_work_reschedule_for_queue(&calibration_wq, &save_work,
+					    K_MSEC(CALIBRATION_RETRY_MS));
+		return;
+	}
+
+	/* Only drop the legacy blobs once everything they held is in records */
+	if (legacy_stored) {
+		ret = settings_delete(CALIBRATION_LEGACY_OFFSET_KEY);
+		if (ret == 0) {
+			ret = settings_delete(CALIBRATION_LEGACY_NOISE_KEY);
+		}
+		if (ret == 0) {
+			legacy_stored = false;
+			LOG_INF("Legacy calibration data migrated");
+		} else {
+			LOG_ERR("Failed to delete legacy calibration data: %d", ret);
+		}
+	}
+}
+
+static int load_record(const char *file_name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	struct calibration_record record;
+	const uint8_t file = file_name[0] - 'a';
+
+	if (file >= CHESS_NUM_FILES || file_name[1] != '\0') {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(record)) {
+		LOG_ERR("Calibration record of file %c has %zu bytes instead of %zu, ignored",
+			'A' + file, len, sizeof(record));
+		return -EINVAL;
+	}
+
+	int rc = read_cb(cb_arg, &record, sizeof(record));
+	if (rc != sizeof(record)) {
+		return (rc < 0) ? rc : -EIO;
+	}
+
+	const bool convert = (record.version == CALIBRATION_RECORD_VERSION_MV);
+
+	if ((record.version != CALIBRATION_RECORD_VERSION && !convert) || record.file != file) {
+		LOG_ERR("Calibration record of file %c has version %u for file %u, ignored",
+			'A' + file, record.version, record.file);
+		return -ENOTSUP;
+	}
+
+	for (uint8_t rank = 0; rank < CHESS_NUM_RANKS; rank++) {
+		/* Same layout, millivolts and microvolts in a version 1 record */
+		calibration_offset_raw[rank][file] =
+			convert ? (int16_t)chessboard_mv_to_raw(record.offset_raw[rank])
+				: record.offset_raw[rank];
+		calibration_noise_q8[rank][file] = convert ? noise_uv_to_q8(record.noise_q8[rank])
+							   : record.noise_q8[rank];
+	}
+	if (convert) {
+		converted_files |= BIT(file);
+	}
+	WRITE_BIT(noise_files, file, record.flags & CALIBRATION_RECORD_NOISE);
+	loaded_record_files |= BIT(file);
+	return 0;
+}
+
+/* Load a legacy blob of all squares, offsets in millivolts or noise in microvolts. The files
+ * already loaded from records keep their values.
+ */
+static int load_legacy(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg,
+		       bool noise)
+{
+	int16_t values[CHESS_NUM_RANKS][CHESS_NUM_FILES];
+
+	/* Deleted once the records are written, even if it cannot be used */
+	legacy_stored = true;
+
+	if (len != sizeof(values)) {
+		LOG_ERR("Legacy calibration %s has %zu bytes instead of %zu, ignored", name, len,
+			sizeof(values));
+		return -EINVAL;
+	}
+
+	int rc = read_cb(cb_arg, values, sizeof(values));
+	if (rc != sizeof(values)) {
+		return (rc < 0) ? rc : -EIO;
+	}
+
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		if (loaded_record_files & BIT(file)) {
+			continue;
+		}
+		for (uint8_t rank = 0; rank < CHESS_NUM_RANKS; rank++) {
+			if (noise) {
+				calibration_noise_q8[rank][file] =
+					noise_uv_to_q8((uint16_t)values[rank][file]);
+			} else {
+				calibration_offset_raw[rank][file] =
+					(int16_t)chessboard_mv_to_raw(values[rank][file]);
+			}
+		}
+		if (noise) {
+			noise_files |= BIT(file);
+		}
+		loaded_legacy_files |= BIT(file);
+	}
+	return 0;
+}
+
 static int chessboard_calibration_set(const char *name, size_t len, settings_read_cb read_cb,
 				      void *cb_arg)
 {
-	int rc;
+	const char *next;
 
-	rc = read_cb(cb_arg, &calibration_offset_mv, sizeof(calibration_offset_mv));
-	if (rc >= 0) {
-		rc = 0;
+	if (settings_name_steq(name, "file", &next) && next != NULL) {
+		return load_record(next, len, read_cb, cb_arg);
+	} else if (settings_name_steq(name, "calibration", &next) && !next) {
+		return load_legacy(name, len, read_cb, cb_arg, false);
+	} else if (settings_name_steq(name, "noise", &next) && !next) {
+		return load_legacy(name, len, read_cb, cb_arg, true);
 	}
 
-	return rc;
+	return -ENOENT;
+}
+
+/* Convert what only the legacy blobs or version 1 records held to current records */
+static int chessboard_calibration_commit(void)
+{
+	const uint8_t migrate = loaded_legacy_files & ~loaded_record_files;
+
+	if (migrate != 0) {
+		LOG_INF("Migrating legacy calibration data of %d files", POPCOUNT(migrate));
+		pending_files |= migrate;
+	}
+	if (converted_files != 0) {
+		LOG_INF("Converting calibration records of %d files to raw counts",
+			POPCOUNT(converted_files));
+		pending_files |= converted_files;
+	}
+	if (pending_files != 0 || legacy_stored) {
+		k_work_reschedule_for_queue(&calibration_wq, &save_work, K_NO_WAIT);
+	}
+	return 0;
 }
 
-static int chessboard_calibration_init(void)
+int chessboard_calibration_init(void)
 {
 	int ret;
 	ret = settings_subsys_init();
@@ -92,19 +653,28 @@ static int chessboard_calibration_init(void)
 		return ret;
 	}
 
+	const struct k_work_queue_config wq_config = {.name = "calibration_wq"};
+
+	k_work_queue_start(&calibration_wq, calibration_wq_stack,
+			   K_THREAD_STACK_SIZEOF(calibration_wq_stack), CALIBRATION_WQ_PRIORITY,
+			   &wq_config);
+
 	ret = settings_register(&chessboard_calibration_setting);
 	if (ret != 0) {
 		LOG_ERR("Failed to register settings handler: %d", ret);
 		return ret;
 	}
-	ret = settings_load();
+	/* Nothing else is stored, but there is no need to walk the other subtrees at boot */
+	ret = settings_load_subtree("calibration");
 	if (ret != 0) {
 		LOG_WRN("No calibration data found, using defaults");
 	} else {
 		LOG_INF("Calibration data loaded successfully");
 	}
 
+	if (chessboard_calibration_apply_thresholds() == 0) {
+		LOG_INF("Using the per square thresholds of the calibration");
+	}
+
 	return 0;
 }
-
-SYS_INIT(chessboard_calibration_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
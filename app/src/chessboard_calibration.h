@@ -1,7 +1,79 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* Number of scans averaged by a calibration unless specified otherwise */
+#define CHESSBOARD_CALIBRATION_DEFAULT_FRAMES 32
+/* At least two scans are needed to measure the noise */
+#define CHESSBOARD_CALIBRATION_MIN_FRAMES     2
+#define CHESSBOARD_CALIBRATION_MAX_FRAMES     1024
 
+/* Load the stored calibration and apply its thresholds, called once at boot */
+int chessboard_calibration_init(void);
+
+/* Offset of a square, the raw counts of the empty square */
+int32_t chessboard_calibration_get_raw(uint8_t file, uint8_t rank);
 int32_t chessboard_calibration_get_mv(uint8_t file, uint8_t rank);
-int chessboard_calibration_calibrate(void);
+
+/**
+ * Offsets of all squares in raw counts, CHESS_SQUARE() order, for the per frame processing. Each
+ * entry is replaced as a whole when a calibration completes.
+ */
+const int16_t *chessboard_calibration_get_offsets(void);
+
+/* Standard deviation of a square over the calibration scans, -1 if it was never measured */
+int32_t chessboard_calibration_get_noise_uv(uint8_t file, uint8_t rank);
+
+/**
+ * Calibrate the empty board: average @p frames full scans per square, use the means as the
+ * offsets and the standard deviations as the noise, and apply thresholds derived from the noise
+ * to every square. The calibration is saved in the background, one record per file, and only the
+ * records that changed are written. The fast setting is a separate step, see
+ * chessboard_calibration_measure_fast().
+ */
+int chessboard_calibration_calibrate(uint16_t frames);
+
+/**
+ * Measure the fast acquisition setting against the precise one from @p frames pairs of full
+ * scans, on a still board with or without pieces. The mean difference of every square becomes
+ * its fast bias, see chessboard_set_fast_bias(), and the spread its confirm margin. Kept in RAM
+ * only.
+ */
+int chessboard_calibration_measure_fast(uint16_t frames);
+
+/**
+ * Confirm margins of all squares in raw counts, CHESS_SQUARE() order: a fast read this close to
+ * a threshold is read again with the precise setting. A default until the fast setting is
+ * measured.
+ */
+const uint16_t *chessboard_calibration_get_confirm_margins(void);
+
+/* State of the calibration storage */
+struct chessboard_calibration_status {
+	/* Files whose record still has to be written, bit n is file n */
+	uint8_t pending_files;
+	/* Files with noise measured during calibration */
+	uint8_t noise_files;
+	/* A record is being written */
+	bool busy;
+	/* Calibration data of older firmware is still stored and has to be deleted */
+	bool legacy_stored;
+	/* The fast setting was measured since boot, its confirm margins apply */
+	bool fast_measured;
+	/* Records written, failed writes and records skipped as unchanged since boot */
+	uint32_t written;
+	uint32_t failed;
+	uint32_t unchanged;
+	int last_error;
+};
+
+void chessboard_calibration_get_status(struct chessboard_calibration_status *status);
+
+/**
+ * Apply the per square thresholds derived from the calibration noise again, e.g. after global
+ * thresholds were set for a test.
+ *
+ * @return 0 on success, -ENODATA if no noise was measured yet.
+ */
+int chessboard_calibration_apply_thresholds(void);
@@ -1,11 +1,24 @@
 #include "chessboard.h"
+#include "chessboard_boot.h"
 #include "chessboard_calibration.h"
+#include "chessboard_detect.h"
+#include "chessboard_filter.h"
+#include "chessboard_game.h"
+#include "chessboard_monitor.h"
+#include "chessboard_recorder.h"
+#include "chessboard_render.h"
+#include "chessboard_scanner.h"
+#include "chessboard_stats.h"
+#include "chessboard_stream.h"
 #include <zephyr/kernel.h>
 #include <zephyr/console/console.h>
+#include <zephyr/drivers/hwinfo.h>
 #include <zephyr/shell/shell.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define SHELL_GETLINE_POLL_MS 10
+
 char *shell_getline(const struct shell *shell, char *buf, const size_t len)
 {
 	if (!buf) {
@@ -21,7 +34,8 @@ char *shell_getline(const struct shell *shell, char *buf, const size_t len)
 
 		shell->iface->api->read(shell->iface, &c, sizeof(c), &cnt);
 		while (cnt == 0) {
-			k_busy_wait(100);
+			/* Sleep rather than spin, a person is typing */
+			k_msleep(SHELL_GETLINE_POLL_MS);
 			shell->iface->api->read(shell->iface, &c, sizeof(c), &cnt);
 		}
 		shell->iface->api->write(shell->iface, &c, sizeof(c), &cnt);
@@ -34,38 +48,45 @@ char *shell_getline(const struct shell *shell, char *buf, const size_t len)
 	return buf;
 }
 
-static int print_mv(const struct shell *sh, int32_t (*get_value_func)(uint8_t, uint8_t))
+static int get_latest_frame(const struct shell *sh, struct chessboard_frame *frame)
 {
-	int32_t val_mv;
-	chessboard_scan();
+	int ret = chessboard_get_frame(frame);
 
-	for (int rank = 7; rank >= 0; rank--) {
-		shell_fprintf(sh, SHELL_NORMAL, "%d", rank + 1);
-		for (int file = 0; file < CHESS_NUM_FILES; file++) {
-			shell_fprintf(sh, SHELL_NORMAL, "|");
-			val_mv = get_value_func(file, rank);
-			shell_fprintf(sh, SHELL_NORMAL, "%4d", val_mv);
-		}
-		shell_fprintf(sh, SHELL_NORMAL, "\n");
+	if (ret == -EAGAIN) {
+		/* Nothing published yet, right after boot */
+		ret = chessboard_wait_frame(frame, 0, K_SECONDS(1));
 	}
-	shell_fprintf(sh, SHELL_NORMAL, "\n");
-	return 0;
+
+	if (ret != 0) {
+		shell_error(sh, "No frame available (%d)", ret);
+	}
+	return ret;
 }
 
-static int print_mv_file(const struct shell *sh, int32_t (*get_value_func)(uint8_t, uint8_t),
-			 uint8_t file)
+/* Board dumps are rendered here and written with a single call. Only used by the shell thread. */
+static char render_buf[CHESSBOARD_RENDER_BOARD_SIZE];
+
+static int print_mv(const struct shell *sh, chessboard_render_value_t get_value_func)
 {
-	int32_t val_mv;
-	chessboard_scan_file(file);
+	struct chessboard_frame frame;
 
-	shell_fprintf(sh, SHELL_NORMAL, "%c", 'A' + file);
-	for (int rank = 0; rank < CHESS_NUM_RANKS; rank++) {
-		shell_fprintf(sh, SHELL_NORMAL, "|");
-		val_mv = get_value_func(file, rank);
-		shell_fprintf(sh, SHELL_NORMAL, "%4d", val_mv);
+	int ret = get_latest_frame(sh, &frame);
+	if (ret != 0) {
+		return ret;
 	}
-	shell_fprintf(sh, SHELL_NORMAL, "\n");
-	return 0;
+
+	ret = chessboard_render_board(render_buf, sizeof(render_buf), &frame, get_value_func);
+	if (ret < 0) {
+		return ret;
+	}
+	return chessboard_monitor_write(sh, render_buf, ret);
+}
+
+static int32_t frame_get_calibration_mv(const struct chessboard_frame *frame, uint8_t file,
+					uint8_t rank)
+{
+	ARG_UNUSED(frame);
+	return chessboard_calibration_get_mv(file, rank);
 }
 
 static bool monitor_command_shall_quit(const struct shell *sh)
@@ -87,116 +108,201 @@ static bool monitor_command_shall_quit(const struct shell *sh)
 	return false;
 }
 
-static int monitor_file(const struct shell *sh, int32_t (*get_value_func)(uint8_t, uint8_t))
+static int start_monitor(const struct shell *sh, uint8_t type)
 {
-	while (1) {
-		for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
-			print_mv_file(sh, get_value_func, file);
-		}
-
-		if (monitor_command_shall_quit(sh)) {
-			break;
-		}
+	int id = chessboard_monitor_start(sh, type);
 
-		k_yield();
+	if (id < 0) {
+		shell_error(sh, "Failed to start monitor (%d)", id);
+		return id;
 	}
+	shell_print(sh, "Monitor %d started, stop it with 'board monitor stop %d'", id, id);
 	return 0;
 }
 
-static int monitor_offset_threshold(const struct shell *sh, int32_t negative_threshold_mv,
-				    int32_t positive_threshold_mv, uint16_t hysteresis_mv)
+static int cmd_board_monitor_moves(const struct shell *sh, size_t argc, char **argv)
 {
-#define STATE_NEGATIVE 0
-#define STATE_POSITIVE 1
-#define STATE_NEUTRAL  2
-#define STATE_UNKNOWN  3
+	return start_monitor(sh, CHESSBOARD_MONITOR_MOVES);
+}
 
-	uint8_t prev_state[CHESS_NUM_FILES][CHESS_NUM_RANKS];
-	for (int file = 0; file < CHESS_NUM_FILES; file++) {
-		for (int rank = 0; rank < CHESS_NUM_RANKS; rank++) {
-			prev_state[file][rank] = STATE_UNKNOWN;
+static int cmd_board_game_new(const struct shell *sh, size_t argc, char **argv)
+{
+	chessboard_game_new();
+	shell_print(sh, "Set up the pieces in the start position to begin");
+	return 0;
+}
+
+static int cmd_board_game_show(const struct shell *sh, size_t argc, char **argv)
+{
+	uint8_t board[CHESS_NUM_SQUARES];
+	bool black_to_move;
+	uint16_t ply;
+
+	if (chessboard_game_get_position(board, &black_to_move, &ply) != 0) {
+		shell_print(sh, "Waiting for the start position");
+		return 0;
+	}
+
+	for (int rank = CHESS_NUM_RANKS - 1; rank >= 0; rank--) {
+		shell_fprintf(sh, SHELL_NORMAL, "%d ", rank + 1);
+		for (int file = 0; file < CHESS_NUM_FILES; file++) {
+			shell_fprintf(sh, SHELL_NORMAL, " %c",
+				      chessboard_render_piece(board[CHESS_SQUARE(file, rank)]));
 		}
+		shell_fprintf(sh, SHELL_NORMAL, "\n");
 	}
+	shell_print(sh, "   a b c d e f g h");
+	shell_print(sh, "Move %u, %s to move", (ply / 2) + 1, black_to_move ? "black" : "white");
+	return 0;
+}
 
-	uint8_t file = 0;
+static int stream_frames(const struct shell *sh, uint32_t interval_ms, uint8_t payload)
+{
+	static uint8_t packet[CHESSBOARD_STREAM_ENCODED_SIZE(CHESSBOARD_STREAM_FRAME_SIZE)];
+	struct chessboard_frame frame = {0};
+	uint32_t last_sent_ms = 0;
+	bool sent = false;
 
-	while (1) {
-		chessboard_scan_file(file);
+	while (!monitor_command_shall_quit(sh)) {
+		if (chessboard_wait_frame(&frame, frame.seq, K_MSEC(100)) != 0) {
+			continue;
+		}
 
-		for (uint8_t rank = 0; rank < CHESS_NUM_RANKS; rank++) {
-			const int32_t mv = chessboard_get_mv_offset(file, rank);
+		if (sent && ((frame.timestamp_ms - last_sent_ms) < interval_ms)) {
+			continue;
+		}
 
-			int32_t negative = negative_threshold_mv;
-			int32_t positive = positive_threshold_mv;
+		int len = chessboard_stream_encode_frame(&frame, payload, packet, sizeof(packet));
+		if (len < 0) {
+			return len;
+		}
 
-			if (prev_state[file][rank] == STATE_POSITIVE) {
-				negative -= hysteresis_mv;
-				positive -= hysteresis_mv;
-			} else if (prev_state[file][rank] == STATE_NEGATIVE) {
-				negative += hysteresis_mv;
-				positive += hysteresis_mv;
-			} else if (prev_state[file][rank] == STATE_NEUTRAL) {
-				negative -= hysteresis_mv;
-				positive += hysteresis_mv;
-			}
+		int ret = chessboard_monitor_write(sh, packet, len);
+		if (ret != 0) {
+			return ret;
+		}
 
-			const bool above = mv > positive;
-			const bool below = mv < negative;
-			const bool within = !above && !below;
-			if ((prev_state[file][rank] != STATE_POSITIVE) && above) {
-				shell_print(sh, "+%c%d", 'A' + file, rank + 1);
-				prev_state[file][rank] = STATE_POSITIVE;
-			} else if ((prev_state[file][rank] != STATE_NEGATIVE) && below) {
-				shell_print(sh, "-%c%d", 'A' + file, rank + 1);
-				prev_state[file][rank] = STATE_NEGATIVE;
-			} else if ((prev_state[file][rank] != STATE_NEUTRAL) && within) {
-				shell_print(sh, " %c%d", 'A' + file, rank + 1);
-				prev_state[file][rank] = STATE_NEUTRAL;
-			} else {
-				// no state change
-			}
+		last_sent_ms = frame.timestamp_ms;
+		sent = true;
+	}
+	return 0;
+}
+
+static int stream_deltas(const struct shell *sh, struct chessboard_stream_delta *delta)
+{
+	static uint8_t packet[CHESSBOARD_STREAM_ENCODED_SIZE(CHESSBOARD_STREAM_DELTA_SIZE)];
+	struct chessboard_frame frame = {0};
+
+	while (!monitor_command_shall_quit(sh)) {
+		if (chessboard_wait_frame(&frame, frame.seq, K_MSEC(100)) != 0) {
+			continue;
 		}
 
-		if (monitor_command_shall_quit(sh)) {
-			break;
+		int len = chessboard_stream_encode_delta(delta, &frame, packet, sizeof(packet));
+		if (len <= 0) {
+			if (len < 0) {
+				return len;
+			}
+			continue;
 		}
 
-		file = (file + 1) % CHESS_NUM_FILES;
-		k_yield();
+		int ret = chessboard_monitor_write(sh, packet, len);
+		if (ret != 0) {
+			return ret;
+		}
 	}
-
 	return 0;
 }
 
 static int cmd_board_monitor_file_voltage(const struct shell *sh, size_t argc, char **argv)
 {
-	monitor_file(sh, chessboard_get_mv);
-	return 0;
+	return start_monitor(sh, CHESSBOARD_MONITOR_VOLTAGE);
 }
 
 static int cmd_board_monitor_file_offset_voltage(const struct shell *sh, size_t argc, char **argv)
 {
-	monitor_file(sh, chessboard_get_mv_offset);
+	return start_monitor(sh, CHESSBOARD_MONITOR_OFFSET);
+}
+
+static int cmd_board_monitor_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	int first = 0;
+	int last = CHESSBOARD_MONITOR_MAX_SESSIONS - 1;
+	int err = 0;
+
+	if (argc >= 2) {
+		first = (int)shell_strtol(argv[1], 10, &err);
+		if (err != 0) {
+			shell_error(sh, "Invalid monitor: %s", argv[1]);
+			return err;
+		}
+		last = first;
+	}
+
+	for (int id = first; id <= last; id++) {
+		int ret = chessboard_monitor_stop(id);
+
+		if (ret == -ENOENT && argc < 2) {
+			continue;
+		} else if (ret != 0) {
+			shell_error(sh, "Failed to stop monitor %d (%d)", id, ret);
+			err = ret;
+		} else {
+			shell_print(sh, "Monitor %d stopped", id);
+		}
+	}
+	return err;
+}
+
+static int cmd_board_monitor_list(const struct shell *sh, size_t argc, char **argv)
+{
+	static const char *const type_names[] = {
+		[CHESSBOARD_MONITOR_VOLTAGE] = "voltage",
+		[CHESSBOARD_MONITOR_OFFSET] = "offset",
+		[CHESSBOARD_MONITOR_THRESHOLD] = "threshold",
+		[CHESSBOARD_MONITOR_MOVES] = "moves",
+	};
+	struct chessboard_monitor_info info;
+
+	shell_print(sh, "%-3s %-10s %10s %10s", "Id", "Monitor", "Printed", "Skipped");
+	for (int id = 0; id < CHESSBOARD_MONITOR_MAX_SESSIONS; id++) {
+		if (chessboard_monitor_get_info(id, &info) == 0) {
+			shell_print(sh, "%-3d %-10s %10u %10u", id, type_names[info.type],
+				    info.printed, info.skipped);
+		}
+	}
 	return 0;
 }
 
 static int cmd_board_monitor_offset_threshold(const struct shell *sh, size_t argc, char **argv)
 {
-	if ((argc < 3) || (argc > 4)) {
+	if ((argc == 2) || (argc > 4)) {
 		shell_print(sh, "Invalid number of arguments (%d)", argc);
 		shell_print(
 			sh,
-			"Usage: board monitor threshold <negative_threshold_mV> "
-			"<positive_threshold_mV> [hysteresis_mV]\n"
+			"Usage: board monitor threshold [<negative_threshold_mV> "
+			"<positive_threshold_mV> [hysteresis_mV]]\n"
 			"- <negative_threshold_mV>: threshold for negative offset notification\n"
 			"- <positive_threshold_mV>: threshold for positive offset notification\n"
 			"- [hysteresis_mV]: optional hysteresis value to avoid notification "
-			"flooding\n");
+			"flooding\n"
+			"Without thresholds, every square uses the thresholds derived from its "
+			"calibration noise\n");
 
 		return -EINVAL;
 	}
 
 	int err = 0;
+
+	if (argc == 1) {
+		err = chessboard_calibration_apply_thresholds();
+		if (err != 0) {
+			shell_error(sh, "No calibration noise, calibrate first (%d)", err);
+			return err;
+		}
+		return start_monitor(sh, CHESSBOARD_MONITOR_THRESHOLD);
+	}
+
 	long negative_threshold_mv = shell_strtol(argv[1], 10, &err);
 
 	if (err != 0) {
@@ -225,55 +331,869 @@ static int cmd_board_monitor_offset_threshold(const struct shell *sh, size_t arg
 		}
 	}
 
-	return monitor_offset_threshold(sh, (int32_t)negative_threshold_mv,
-					(int32_t)positive_threshold_mv, (uint16_t)hysteresis_mv);
+	const int32_t hysteresis = chessboard_mv_to_raw(hysteresis_mv);
+
+	err = chessboard_detect_set_thresholds(chessboard_mv_to_raw(negative_threshold_mv),
+					       chessboard_mv_to_raw(positive_threshold_mv),
+					       (uint16_t)MIN(hysteresis, UINT16_MAX));
+	if (err != 0) {
+		shell_error(sh, "Invalid thresholds (%d)", err);
+		return err;
+	}
+
+	return start_monitor(sh, CHESSBOARD_MONITOR_THRESHOLD);
+}
+
+static int parse_stream_payload(const struct shell *sh, const char *arg, uint8_t *payload)
+{
+	if (strcmp(arg, "raw") == 0) {
+		*payload = CHESSBOARD_STREAM_PAYLOAD_RAW;
+	} else if (strcmp(arg, "offset") == 0) {
+		*payload = CHESSBOARD_STREAM_PAYLOAD_OFFSET;
+	} else {
+		shell_error(sh, "Invalid payload: %s", arg);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int cmd_board_stream_full(const struct shell *sh, size_t argc, char **argv)
+{
+	int err = 0;
+	unsigned long rate_hz = shell_strtoul(argv[1], 10, &err);
+
+	if (err != 0) {
+		shell_error(sh, "Invalid frame rate: %s", argv[1]);
+		return err;
+	}
+
+	uint8_t payload;
+
+	err = parse_stream_payload(sh, argv[2], &payload);
+	if (err != 0) {
+		return err;
+	}
+
+	return stream_frames(sh, (rate_hz == 0) ? 0 : (1000 / rate_hz), payload);
+}
+
+static int cmd_board_stream_delta(const struct shell *sh, size_t argc, char **argv)
+{
+	struct chessboard_stream_delta delta;
+	uint8_t payload;
+	int err;
+
+	err = parse_stream_payload(sh, argv[1], &payload);
+	if (err != 0) {
+		return err;
+	}
+
+	unsigned long keyframe_interval = shell_strtoul(argv[2], 10, &err);
+	if ((err != 0) || (keyframe_interval == 0) || (keyframe_interval > UINT16_MAX)) {
+		shell_error(sh, "Invalid keyframe interval: %s", argv[2]);
+		return -EINVAL;
+	}
+
+	unsigned long deadband_mv = shell_strtoul(argv[3], 10, &err);
+	if ((err != 0) || (deadband_mv > UINT16_MAX)) {
+		shell_error(sh, "Invalid dead-band: %s", argv[3]);
+		return -EINVAL;
+	}
+
+	chessboard_stream_delta_init(&delta, payload, (uint16_t)keyframe_interval,
+				     (uint16_t)MIN(chessboard_mv_to_raw(deadband_mv), UINT16_MAX));
+	return stream_deltas(sh, &delta);
 }
 
 static int cmd_print_board_voltage(const struct shell *sh, size_t argc, char **argv)
 {
-	print_mv(sh, chessboard_get_mv);
+	print_mv(sh, chessboard_frame_get_mv);
 	return 0;
 }
 
 static int cmd_print_board_offset_voltage(const struct shell *sh, size_t argc, char **argv)
 {
-	print_mv(sh, chessboard_get_mv_offset);
+	print_mv(sh, chessboard_frame_get_mv_offset);
 	return 0;
 }
 
 static int cmd_print_board_calibration(const struct shell *sh, size_t argc, char **argv)
 {
-	print_mv(sh, chessboard_calibration_get_mv);
+	print_mv(sh, frame_get_calibration_mv);
 	return 0;
 }
 
+static int32_t frame_get_calibration_noise_uv(const struct chessboard_frame *frame, uint8_t file,
+					      uint8_t rank)
+{
+	ARG_UNUSED(frame);
+	return chessboard_calibration_get_noise_uv(file, rank);
+}
+
+static int cmd_print_board_noise(const struct shell *sh, size_t argc, char **argv)
+{
+	print_mv(sh, frame_get_calibration_noise_uv);
+	return 0;
+}
+
+static void print_files(const struct shell *sh, const char *name, uint8_t files)
+{
+	shell_fprintf(sh, SHELL_NORMAL, "%s", name);
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		shell_fprintf(sh, SHELL_NORMAL, " %c", (files & BIT(file)) ? 'A' + file : '-');
+	}
+	shell_fprintf(sh, SHELL_NORMAL, "\n");
+}
+
+static int cmd_board_calibration_status(const struct shell *sh, size_t argc, char **argv)
+{
+	struct chessboard_calibration_status status;
+
+	chessboard_calibration_get_status(&status);
+	print_files(sh, "Pending:", status.pending_files);
+	print_files(sh, "Noise:  ", status.noise_files);
+	shell_print(sh, "State: %s%s",
+		    status.busy ? "writing" : ((status.pending_files != 0) ? "pending" : "saved"),
+		    status.legacy_stored ? ", legacy data not deleted yet" : "");
+	shell_print(sh, "Records written %u, failed %u, unchanged %u, last error %d",
+		    status.written, status.failed, status.unchanged, status.last_error);
+	return 0;
+}
+
+static const char *const profile_names[] = {
+	[CHESSBOARD_SCANNER_PROFILE_PRECISE] = "precise",
+	[CHESSBOARD_SCANNER_PROFILE_FAST] = "fast",
+	[CHESSBOARD_SCANNER_PROFILE_CONFIRM] = "confirm",
+};
+
 static int cmd_set_board_calibration(const struct shell *sh, size_t argc, char **argv)
 {
-	int ret = chessboard_calibration_calibrate();
+	unsigned long frames = CHESSBOARD_CALIBRATION_DEFAULT_FRAMES;
+	int err = 0;
+
+	if (argc >= 2) {
+		frames = shell_strtoul(argv[1], 10, &err);
+		if ((err != 0) || (frames < CHESSBOARD_CALIBRATION_MIN_FRAMES) ||
+		    (frames > CHESSBOARD_CALIBRATION_MAX_FRAMES)) {
+			shell_error(sh, "Invalid number of scans: %s (%d to %d)", argv[1],
+				    CHESSBOARD_CALIBRATION_MIN_FRAMES,
+				    CHESSBOARD_CALIBRATION_MAX_FRAMES);
+			return -EINVAL;
+		}
+	}
+
+	int ret = chessboard_calibration_calibrate((uint16_t)frames);
 	if (ret != 0) {
 		shell_print(sh, "Calibration failed: %d", ret);
 		return ret;
 	}
 
-	shell_print(sh, "Calibration complete");
+	shell_print(sh, "Calibration complete, saving in the background, see 'board calib status'");
+
+	/* Only while the detection relies on fast reads, 'board profile' measures it otherwise */
+	if (chessboard_scanner_get_profile() == CHESSBOARD_SCANNER_PROFILE_PRECISE) {
+		return 0;
+	}
+
+	shell_print(sh, "Measuring the fast setting for the %s profile, %lu more scans of each...",
+		    profile_names[chessboard_scanner_get_profile()], frames);
+	ret = chessboard_calibration_measure_fast((uint16_t)frames);
+	if (ret != 0) {
+		shell_error(sh, "Failed to measure the fast setting: %d", ret);
+		return ret;
+	}
+	shell_print(sh, "Fast setting measured, see 'board profile'");
+	return 0;
+}
+
+static int scan_async_blocking(void)
+{
+	static struct k_poll_signal done = K_POLL_SIGNAL_INITIALIZER(done);
+	struct k_poll_event event =
+		K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &done);
+	unsigned int signaled;
+	int result;
+
+	k_poll_signal_reset(&done);
+	int err = chessboard_scan_async(CHESS_ALL_SQUARES, NULL, &done);
+	if (err != 0) {
+		return err;
+	}
+
+	k_poll(&event, 1, K_FOREVER);
+	k_poll_signal_check(&done, &signaled, &result);
+	return result;
+}
+
+/* Full board rate of the scanner thread: wait for published frames until they have acquired every
+ * square @p frames times, timed between the first and the last frame
+ */
+static int background_fps(const struct shell *sh, unsigned long frames)
+{
+	struct chessboard_frame frame;
+	uint64_t squares = 0;
+
+	chessboard_scanner_wake();
+	int err = chessboard_wait_frame(&frame, 0, K_SECONDS(1));
+	if (err == 0) {
+		/* The latest frame may be long published, time from the next one */
+		err = chessboard_wait_frame(&frame, frame.seq, K_SECONDS(1));
+	}
+	if (err != 0) {
+		shell_error(sh, "No frame from the scanner: %d", err);
+		return err;
+	}
+
+	const uint32_t start = frame.ready_cycles;
+	uint32_t published = 0;
+
+	while (squares < (uint64_t)frames * CHESS_NUM_SQUARES) {
+		err = chessboard_wait_frame(&frame, frame.seq, K_SECONDS(1));
+		if (err != 0) {
+			shell_error(sh, "No frame from the scanner: %d", err);
+			return err;
+		}
+		squares += (uint64_t)__builtin_popcountll(frame.scanned);
+		published++;
+	}
+	const uint64_t us = MAX(k_cyc_to_us_floor64(frame.ready_cycles - start), 1);
+
+	shell_print(sh, "Profile %s: %u frames in %llu us, %llu.%02llu full board fps",
+		    profile_names[chessboard_scanner_get_profile()], published, us,
+		    (squares * 1000000ULL) / (us * CHESS_NUM_SQUARES),
+		    ((squares * 100000000ULL) / (us * CHESS_NUM_SQUARES)) % 100);
+	return 0;
+}
+
+static int cmd_board_fps(const struct shell *sh, size_t argc, char **argv)
+{
+	unsigned long frames = 10;
+	bool async = false;
+	int err = 0;
+
+	if (argc >= 2) {
+		frames = shell_strtoul(argv[1], 10, &err);
+		if ((err != 0) || (frames == 0)) {
+			shell_error(sh, "Invalid number of frames: %s", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+	if (argc >= 3) {
+		if (strcmp(argv[2], "background") == 0) {
+			return background_fps(sh, frames);
+		}
+		if (strcmp(argv[2], "async") != 0) {
+			shell_error(sh, "Unknown scan mode: %s", argv[2]);
+			return -EINVAL;
+		}
+		async = true;
+	}
+
+	const uint32_t start = k_cycle_get_32();
+	for (unsigned long i = 0; i < frames; i++) {
+		err = async ? scan_async_blocking() : chessboard_scan();
+		if (err != 0) {
+			shell_error(sh, "Scan failed: %d", err);
+			return err;
+		}
+	}
+	const uint64_t us = MAX(k_cyc_to_us_floor64(k_cycle_get_32() - start), 1);
+
+	shell_print(sh, "%lu frames in %llu us, %llu us/frame, %llu.%02llu fps", frames, us,
+		    us / frames, (frames * 1000000ULL) / us, ((frames * 100000000ULL) / us) % 100);
+	return 0;
+}
+
+static int cmd_board_occupancy(const struct shell *sh, size_t argc, char **argv)
+{
+	struct chessboard_bitboards bb;
+
+	chessboard_get_bitboards(&bb);
+	shell_print(sh, "positive: 0x%016llx", bb.positive);
+	shell_print(sh, "negative: 0x%016llx", bb.negative);
+	shell_print(sh, "changed:  0x%016llx", bb.changed);
+	return 0;
+}
+
+static int cmd_board_scanner(const struct shell *sh, size_t argc, char **argv)
+{
+	if (argc >= 2) {
+		int err = 0;
+		unsigned long period_ms = shell_strtoul(argv[1], 10, &err);
+
+		if (err != 0) {
+			shell_error(sh, "Invalid period: %s", argv[1]);
+			return err;
+		}
+		chessboard_scanner_set_period((uint32_t)period_ms);
+	}
+
+	struct chessboard_frame frame;
+
+	const uint8_t active = chessboard_scanner_get_active_files();
+
+	shell_print(sh, "Scan period: %u ms, full refresh: %u ms", chessboard_scanner_get_period(),
+		    CHESSBOARD_SCANNER_FULL_REFRESH_MS);
+	shell_fprintf(sh, SHELL_NORMAL, "Active files:");
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		if (active & BIT(file)) {
+			shell_fprintf(sh, SHELL_NORMAL, " %c", 'A' + file);
+		}
+	}
+	shell_fprintf(sh, SHELL_NORMAL, "\n");
+	if (chessboard_get_frame(&frame) == 0) {
+		shell_print(sh, "Latest frame: #%u at %u ms, scanned 0x%016llx", frame.seq,
+			    frame.timestamp_ms, frame.scanned);
+	}
+	return 0;
+}
+
+static int cmd_board_profile(const struct shell *sh, size_t argc, char **argv)
+{
+	struct chessboard_calibration_status status;
+	struct chessboard_scanner_stats stats;
+	int16_t bias[CHESS_NUM_SQUARES];
+
+	chessboard_calibration_get_status(&status);
+
+	if (argc >= 2) {
+		uint8_t profile;
+
+		for (profile = 0; profile < ARRAY_SIZE(profile_names); profile++) {
+			if (strcmp(argv[1], profile_names[profile]) == 0) {
+				break;
+			}
+		}
+		if (profile >= ARRAY_SIZE(profile_names)) {
+			shell_error(sh, "Unknown profile: %s", argv[1]);
+			return -EINVAL;
+		}
+
+		/* Fast reads need their bias and margins before they drive the detection */
+		if ((profile != CHESSBOARD_SCANNER_PROFILE_PRECISE) && !status.fast_measured) {
+			shell_print(sh, "Measuring the fast setting...");
+			int err = chessboard_calibration_measure_fast(
+				CHESSBOARD_CALIBRATION_DEFAULT_FRAMES);
+			if (err != 0) {
+				shell_error(sh, "Failed to measure the fast setting: %d", err);
+				return err;
+			}
+			status.fast_measured = true;
+		}
+		chessboard_scanner_set_profile(profile);
+	}
+
+	const uint16_t *margins = chessboard_calibration_get_confirm_margins();
+	int32_t min_bias = INT16_MAX;
+	int32_t max_bias = INT16_MIN;
+	uint16_t min_margin = UINT16_MAX;
+	uint16_t max_margin = 0;
+
+	chessboard_get_fast_bias(bias);
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		min_bias = MIN(min_bias, bias[square]);
+		max_bias = MAX(max_bias, bias[square]);
+		min_margin = MIN(min_margin, margins[square]);
+		max_margin = MAX(max_margin, margins[square]);
+	}
+
+	chessboard_scanner_get_stats(&stats);
+	shell_print(sh, "Profile: %s", profile_names[chessboard_scanner_get_profile()]);
+	shell_print(sh, "Fast setting %s: bias %d to %d mV, confirm margin %d to %d mV",
+		    status.fast_measured ? "measured" : "not measured",
+		    chessboard_raw_to_mv(min_bias), chessboard_raw_to_mv(max_bias),
+		    chessboard_raw_to_mv(min_margin), chessboard_raw_to_mv(max_margin));
+	shell_print(sh, "Confirm sweeps: %u, squares scanned again: %u", stats.confirm_sweeps,
+		    stats.confirm_squares);
+	return 0;
+}
+
+static int cmd_board_idle(const struct shell *sh, size_t argc, char **argv)
+{
+	static const char *const mode_names[] = {
+		[CHESSBOARD_SCANNER_MODE_ACTIVE] = "active",
+		[CHESSBOARD_SCANNER_MODE_IDLE] = "idle",
+	};
+	struct chessboard_scanner_stats stats;
+
+	if (argc >= 2) {
+		if (strcmp(argv[1], "reset") != 0) {
+			shell_error(sh, "Usage: board idle [reset]");
+			return -EINVAL;
+		}
+		chessboard_scanner_reset_stats();
+	}
+
+	chessboard_scanner_get_stats(&stats);
+	shell_print(sh, "Mode: %s", mode_names[stats.mode]);
+	shell_print(sh, "Wakes: %u, wake latency last %u ms, max %u ms", stats.wakes,
+		    stats.last_wake_latency_ms, stats.max_wake_latency_ms);
+	for (int mode = 0; mode < CHESSBOARD_SCANNER_NUM_MODES; mode++) {
+		shell_print(sh, "%-6s %u ms, CPU load %u.%02u%%", mode_names[mode],
+			    stats.mode_time_ms[mode], stats.cpu_load[mode] / 100,
+			    stats.cpu_load[mode] % 100);
+	}
+	shell_print(sh, "Deadline misses: %u, start jitter last %u us, max %u us",
+		    stats.deadline_misses, stats.last_jitter_us, stats.max_jitter_us);
+	shell_print(sh, "Frames dropped from the bus: %u", stats.bus_drops);
+	return 0;
+}
+
+static void print_file_counters(const struct shell *sh, const char *name,
+				const uint32_t counters[CHESS_NUM_FILES])
+{
+	shell_fprintf(sh, SHELL_NORMAL, "%-14s", name);
+	for (int file = 0; file < CHESS_NUM_FILES; file++) {
+		shell_fprintf(sh, SHELL_NORMAL, " %c:%u", 'A' + file, counters[file]);
+	}
+	shell_fprintf(sh, SHELL_NORMAL, "\n");
+}
+
+static int cmd_board_boot(const struct shell *sh, size_t argc, char **argv)
+{
+	static const char *const phase_names[] = {
+		[CHESSBOARD_BOOT_WATCHDOG] = "watchdog",
+		[CHESSBOARD_BOOT_SCAN_READY] = "scan_ready",
+		[CHESSBOARD_BOOT_CALIBRATION] = "calibration",
+		[CHESSBOARD_BOOT_SCANNER] = "scanner",
+		[CHESSBOARD_BOOT_FIRST_FRAME] = "first_frame",
+		[CHESSBOARD_BOOT_GAME_RESUMED] = "game_resumed",
+		[CHESSBOARD_BOOT_GAME_STARTED] = "game_started",
+		[CHESSBOARD_BOOT_CONSOLE] = "console",
+	};
+	static const struct {
+		uint32_t flag;
+		const char *name;
+	} causes[] = {
+		{RESET_PIN, "pin"},
+		{RESET_SOFTWARE, "software"},
+		{RESET_BROWNOUT, "brownout"},
+		{RESET_POR, "power-on"},
+		{RESET_WATCHDOG, "watchdog"},
+		{RESET_DEBUG, "debug"},
+		{RESET_LOW_POWER_WAKE, "low power wake"},
+		{RESET_CPU_LOCKUP, "cpu lockup"},
+	};
+	struct chessboard_boot_info info;
+
+	chessboard_boot_get_info(&info);
+
+	shell_fprintf(sh, SHELL_NORMAL, "Reset cause: 0x%08x", info.reset_cause);
+	for (int i = 0; i < ARRAY_SIZE(causes); i++) {
+		if (info.reset_cause & causes[i].flag) {
+			shell_fprintf(sh, SHELL_NORMAL, " %s", causes[i].name);
+		}
+	}
+	shell_fprintf(sh, SHELL_NORMAL, "\n");
+
+	for (int phase = 0; phase < CHESSBOARD_BOOT_NUM_PHASES; phase++) {
+		if (info.reached & BIT(phase)) {
+			shell_print(sh, "%-13s %10u us", phase_names[phase], info.phase_us[phase]);
+		} else {
+			shell_print(sh, "%-13s %13s", phase_names[phase], "-");
+		}
+	}
+	return 0;
+}
+
+static const char *trigger_name(uint8_t flags)
+{
+	switch (flags & (CHESS_MOVE_ILLEGAL | CHESS_MOVE_AMBIGUOUS)) {
+	case CHESS_MOVE_ILLEGAL:
+		return "illegal";
+	case CHESS_MOVE_AMBIGUOUS:
+		return "ambiguous";
+	case 0:
+		return "off";
+	default:
+		return "any";
+	}
+}
+
+static int cmd_board_recorder_status(const struct shell *sh, size_t argc, char **argv)
+{
+	struct chessboard_recorder_status status;
+
+	chessboard_recorder_get_status(&status);
+	if (status.frozen && status.triggered_by != 0) {
+		shell_print(sh, "Frozen by an %s position at %u ms",
+			    trigger_name(status.triggered_by), status.triggered_ms);
+	} else {
+		shell_print(sh, "%s, trigger: %s", status.frozen ? "Frozen" : "Recording",
+			    trigger_name(status.trigger));
+	}
+	shell_print(sh, "Used: %u of %u bytes, %u records, newest at %u ms", status.used,
+		    CHESSBOARD_RECORDER_SIZE, status.records, status.newest_ms);
+	shell_print(sh, "Frames: %u recorded, %u keyframes, %u unchanged, %u skipped",
+		    status.frames, status.keyframes, status.unchanged, status.skipped);
+	shell_print(sh, "Moves: %u, records overwritten: %u", status.moves, status.overwritten);
+	return 0;
+}
+
+static int cmd_board_recorder_freeze(const struct shell *sh, size_t argc, char **argv)
+{
+	chessboard_recorder_freeze();
+	shell_print(sh, "Recorder frozen");
+	return 0;
+}
+
+static int cmd_board_recorder_resume(const struct shell *sh, size_t argc, char **argv)
+{
+	chessboard_recorder_resume();
+	shell_print(sh, "Recording");
+	return 0;
+}
+
+static int cmd_board_recorder_trigger(const struct shell *sh, size_t argc, char **argv)
+{
+	static const uint8_t triggers[] = {
+		0,
+		CHESS_MOVE_ILLEGAL,
+		CHESS_MOVE_AMBIGUOUS,
+		CHESS_MOVE_ILLEGAL | CHESS_MOVE_AMBIGUOUS,
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(triggers); i++) {
+		if (strcmp(argv[1], trigger_name(triggers[i])) == 0) {
+			chessboard_recorder_set_trigger(triggers[i]);
+			return 0;
+		}
+	}
+
+	shell_error(sh, "Usage: board recorder trigger <off|illegal|ambiguous|any>");
+	return -EINVAL;
+}
+
+static void print_recorder_entry(const struct shell *sh,
+				 const struct chessboard_recorder_entry *entry)
+{
+	/* Only used by the shell thread */
+	static struct chessboard_frame frame;
+	int len = 0;
+
+	switch (entry->tag) {
+	case CHESSBOARD_RECORDER_KEYFRAME:
+		shell_print(sh, "%u ms #%u keyframe", entry->timestamp_ms, entry->seq);
+		memcpy(frame.raw, entry->raw, sizeof(frame.raw));
+		len = chessboard_render_board(render_buf, sizeof(render_buf), &frame,
+					      chessboard_frame_get_mv);
+		break;
+	case CHESSBOARD_RECORDER_DELTA:
+		shell_fprintf(sh, SHELL_NORMAL, "%u ms #%u", entry->timestamp_ms, entry->seq);
+		for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+			if (entry->changed & BIT64(square)) {
+				shell_fprintf(sh, SHELL_NORMAL, " %c%d:%d",
+					      'A' + (square % CHESS_NUM_FILES),
+					      (square / CHESS_NUM_FILES) + 1,
+					      chessboard_raw_to_mv(entry->raw[square]));
+			}
+		}
+		shell_fprintf(sh, SHELL_NORMAL, "\n");
+		break;
+	default:
+		shell_fprintf(sh, SHELL_NORMAL, "%u ms", entry->timestamp_ms);
+		len = chessboard_render_move(render_buf, sizeof(render_buf), &entry->move);
+		break;
+	}
+
+	if (len > 0) {
+		chessboard_monitor_write(sh, render_buf, len);
+	}
+}
+
+static int dump_recording_text(const struct shell *sh, size_t len)
+{
+	/* Too large for the shell thread stack */
+	static struct chessboard_recorder_reader reader;
+	int ret;
+
+	chessboard_recorder_reader_init(&reader, len);
+	while ((ret = chessboard_recorder_next(&reader)) == 0) {
+		print_recorder_entry(sh, &reader.entry);
+	}
+
+	if (ret != -ENODATA) {
+		shell_error(sh, "Malformed record at byte %zu (%d)", reader.offset, ret);
+		return ret;
+	}
+	return 0;
+}
+
+static int dump_recording_binary(const struct shell *sh, size_t len)
+{
+	static uint8_t packet[CHESSBOARD_STREAM_ENCODED_SIZE(CHESSBOARD_STREAM_RECORDING_SIZE)];
+	const uint16_t count = DIV_ROUND_UP(len, CHESSBOARD_STREAM_CHUNK_SIZE);
+	uint8_t chunk[CHESSBOARD_STREAM_CHUNK_SIZE];
+
+	for (uint16_t index = 0; index < count; index++) {
+		const size_t chunk_len = chessboard_recorder_read(
+			(size_t)index * CHESSBOARD_STREAM_CHUNK_SIZE, chunk, sizeof(chunk));
+		int ret = chessboard_stream_encode_recording(
+			CHESSBOARD_RECORDER_FORMAT, index, count, chunk, chunk_len, packet,
+			sizeof(packet));
+		if (ret < 0) {
+			return ret;
+		}
+
+		ret = chessboard_monitor_write(sh, packet, ret);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+	return 0;
+}
+
+static int cmd_board_recorder_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	const bool binary = (strcmp(argv[1], "binary") == 0);
+
+	if (!binary && (strcmp(argv[1], "text") != 0)) {
+		shell_error(sh, "Usage: board recorder dump <text|binary>");
+		return -EINVAL;
+	}
+
+	/* Recording pauses while the buffer is read */
+	int len = chessboard_recorder_begin_read();
+	if (len < 0) {
+		shell_error(sh, "Recorder busy (%d)", len);
+		return len;
+	}
+
+	int ret = binary ? dump_recording_binary(sh, len) : dump_recording_text(sh, len);
+
+	chessboard_recorder_end_read();
+	return ret;
+}
+
+static int cmd_board_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	static const char *const phase_names[] = {
+		[CHESSBOARD_STATS_PHASE_MUX] = "mux",
+		[CHESSBOARD_STATS_PHASE_SETUP] = "setup",
+		[CHESSBOARD_STATS_PHASE_CONVERSION] = "conversion",
+		[CHESSBOARD_STATS_PHASE_STORE] = "store",
+		[CHESSBOARD_STATS_PHASE_CALIBRATION] = "calibration",
+	};
+	struct chessboard_stats stats;
+	uint64_t total_cycles = 0;
+
+	if (argc >= 2) {
+		if (strcmp(argv[1], "reset") != 0) {
+			shell_error(sh, "Usage: board stats [reset]");
+			return -EINVAL;
+		}
+		chessboard_stats_reset();
+	}
+
+	chessboard_stats_get(&stats);
+	for (int phase = 0; phase < CHESSBOARD_STATS_NUM_PHASES; phase++) {
+		total_cycles += stats.phases[phase].cycles;
+	}
+
+	shell_print(sh, "%-12s %10s %12s %11s %8s", "Phase", "Items", "Cycles", "Cycles/item",
+		    "Share");
+	for (int phase = 0; phase < CHESSBOARD_STATS_NUM_PHASES; phase++) {
+		const struct chessboard_stats_phase *p = &stats.phases[phase];
+		const uint32_t share = (total_cycles == 0) ? 0 : (p->cycles * 1000) / total_cycles;
+
+		shell_print(sh, "%-12s %10u %12llu %11llu %5u.%u%%", phase_names[phase], p->items,
+			    p->cycles, (p->items == 0) ? 0 : p->cycles / p->items, share / 10,
+			    share % 10);
+	}
+	shell_print(sh, "Cycle counter: %u Hz", sys_clock_hw_cycles_per_sec());
+
+	if (stats.frames == 0) {
+		shell_print(sh, "Frames: 0");
+	} else {
+		shell_print(sh, "Frames: %u, duration min %u us, avg %llu us, max %u us",
+			    stats.frames, stats.frame_min_us, stats.frame_total_us / stats.frames,
+			    stats.frame_max_us);
+		for (int bin = 0; bin < CHESSBOARD_STATS_HISTOGRAM_BINS; bin++) {
+			if (stats.frame_histogram[bin] == 0) {
+				continue;
+			}
+			if (bin == CHESSBOARD_STATS_HISTOGRAM_BINS - 1) {
+				shell_print(sh, "  >= %6u us: %u", 1u << bin,
+					    stats.frame_histogram[bin]);
+			} else {
+				shell_print(sh, "  <  %6u us: %u", 2u << bin,
+					    stats.frame_histogram[bin]);
+			}
+		}
+	}
+
+	print_file_counters(sh, "ADC errors:", stats.adc_errors);
+	print_file_counters(sh, "Logged errors:", stats.logged_errors);
+	return 0;
+}
+
+/* Parse a square name such as "e4" or "E4" */
+static int parse_square(const char *name, uint8_t *square)
+{
+	const int file = (name[0] >= 'a') ? (name[0] - 'a') : (name[0] - 'A');
+	const int rank = name[1] - '1';
+
+	if (file < 0 || file >= CHESS_NUM_FILES || rank < 0 || rank >= CHESS_NUM_RANKS ||
+	    name[2] != '\0') {
+		return -EINVAL;
+	}
+
+	*square = CHESS_SQUARE(file, rank);
+	return 0;
+}
+
+static int cmd_board_read(const struct shell *sh, size_t argc, char **argv)
+{
+	uint64_t mask = 0;
+	uint8_t square;
+
+	for (size_t i = 1; i < argc; i++) {
+		if (parse_square(argv[i], &square) != 0) {
+			shell_error(sh, "Invalid square: %s", argv[i]);
+			return -EINVAL;
+		}
+		mask |= BIT64(square);
+	}
+
+	const uint32_t start = k_cycle_get_32();
+	int ret = chessboard_scan_squares(mask);
+	const uint32_t cycles = k_cycle_get_32() - start;
+
+	if (ret != 0) {
+		shell_error(sh, "Scan failed (%d)", ret);
+		return ret;
+	}
+
+	for (size_t i = 1; i < argc; i++) {
+		parse_square(argv[i], &square);
+		shell_print(sh, "%c%d: %d mV", 'A' + (square % CHESS_NUM_FILES),
+			    (square / CHESS_NUM_FILES) + 1,
+			    chessboard_get_mv(square % CHESS_NUM_FILES, square / CHESS_NUM_FILES));
+	}
+	shell_print(sh, "Scan took %u us", k_cyc_to_us_floor32(cycles));
+	return 0;
+}
+
+static const char *const filter_names[] = {
+	[CHESSBOARD_FILTER_NONE] = "none",
+	[CHESSBOARD_FILTER_EMA] = "ema",
+	[CHESSBOARD_FILTER_MEDIAN] = "median",
+	[CHESSBOARD_FILTER_BOXCAR] = "boxcar",
+};
+
+static int cmd_board_filter(const struct shell *sh, size_t argc, char **argv)
+{
+	uint8_t kind;
+	uint8_t param;
+
+	if (argc >= 2) {
+		unsigned long value = 0;
+		int err = 0;
+
+		for (kind = 0; kind < ARRAY_SIZE(filter_names); kind++) {
+			if (strcmp(argv[1], filter_names[kind]) == 0) {
+				break;
+			}
+		}
+		if (kind == ARRAY_SIZE(filter_names)) {
+			shell_error(sh, "Unknown filter: %s", argv[1]);
+			return -EINVAL;
+		}
+
+		if (argc >= 3) {
+			value = shell_strtoul(argv[2], 10, &err);
+		} else if (kind != CHESSBOARD_FILTER_NONE) {
+			shell_error(sh, "Missing parameter for %s", argv[1]);
+			return -EINVAL;
+		}
+
+		if (err != 0 || value > UINT8_MAX ||
+		    chessboard_filter_configure(kind, (uint8_t)value) != 0) {
+			shell_error(sh, "Invalid parameter for %s: %s", argv[1],
+				    argc >= 3 ? argv[2] : "");
+			return -EINVAL;
+		}
+	}
+
+	chessboard_filter_get_config(&kind, &param);
+	switch (kind) {
+	case CHESSBOARD_FILTER_EMA:
+		shell_print(sh, "Filter: ema, alpha 1/%u", 1u << param);
+		break;
+	case CHESSBOARD_FILTER_MEDIAN:
+	case CHESSBOARD_FILTER_BOXCAR:
+		shell_print(sh, "Filter: %s, %u frames", filter_names[kind], param);
+		break;
+	default:
+		shell_print(sh, "Filter: none");
+		break;
+	}
 	return 0;
 }
 
 SHELL_STATIC_SUBCMD_SET_CREATE(calib_cmds,
 			       SHELL_CMD(get, NULL, "Print the chess board calibration",
 					 cmd_print_board_calibration),
-			       SHELL_CMD(set, NULL, "Set the chess board calibration",
-					 cmd_set_board_calibration),
+			       SHELL_CMD_ARG(set, NULL,
+					     "Calibrate the empty board, averaging the given "
+					     "number of scans per square, and measure the fast "
+					     "setting again with a fast profile: set [scans]",
+					     cmd_set_board_calibration, 1, 1),
+			       SHELL_CMD(status, NULL,
+					 "Show which calibration records are saved",
+					 cmd_board_calibration_status),
+			       SHELL_CMD(noise, NULL,
+					 "Print the noise of every square measured during "
+					 "calibration in microvolts",
+					 cmd_print_board_noise),
 			       SHELL_SUBCMD_SET_END);
 
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	recorder_cmds,
+	SHELL_CMD(status, NULL, "Show the state of the flight recorder", cmd_board_recorder_status),
+	SHELL_CMD_ARG(dump, NULL,
+		      "Print the recording or send it as stream packets: dump <text|binary>",
+		      cmd_board_recorder_dump, 2, 0),
+	SHELL_CMD(freeze, NULL, "Stop recording and keep the recording", cmd_board_recorder_freeze),
+	SHELL_CMD(resume, NULL, "Continue recording and arm the trigger again",
+		  cmd_board_recorder_resume),
+	SHELL_CMD_ARG(trigger, NULL,
+		      "Freeze after a rejected position: trigger <off|illegal|ambiguous|any>",
+		      cmd_board_recorder_trigger, 2, 0),
+	SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	stream_cmds,
+	SHELL_CMD_ARG(full, NULL,
+		      "Every frame in full: full <frame_rate_hz, 0 for every frame> <raw|offset>",
+		      cmd_board_stream_full, 3, 0),
+	SHELL_CMD_ARG(delta, NULL,
+		      "Keyframes plus changed squares only: "
+		      "delta <raw|offset> <keyframe_interval> <deadband_mV>",
+		      cmd_board_stream_delta, 4, 0),
+	SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	game_cmds,
+	SHELL_CMD(new, NULL, "Start a new game once the start position is set up",
+		  cmd_board_game_new),
+	SHELL_CMD(show, NULL, "Print the current game position", cmd_board_game_show),
+	SHELL_SUBCMD_SET_END);
+
 SHELL_STATIC_SUBCMD_SET_CREATE(
 	monitor,
 	SHELL_CMD(voltage, NULL, "Monitor chess board voltages", cmd_board_monitor_file_voltage),
 	SHELL_CMD(offset, NULL, "Monitor chess board offset voltages",
 		  cmd_board_monitor_file_offset_voltage),
 	SHELL_CMD(threshold, NULL,
-		  "Notify with hysteresis: threshold <negative_mV> <positive_mV> [hysteresis_mV]",
+		  "Notify with hysteresis: threshold [<negative_mV> <positive_mV> "
+		  "[hysteresis_mV]], calibrated per square thresholds without arguments",
 		  cmd_board_monitor_offset_threshold),
+	SHELL_CMD(moves, NULL, "Monitor moves played on the board", cmd_board_monitor_moves),
+	SHELL_CMD_ARG(stop, NULL, "Stop a monitor, or all of them: stop [id]",
+		      cmd_board_monitor_stop, 1, 1),
+	SHELL_CMD(list, NULL, "List the running monitors", cmd_board_monitor_list),
 	SHELL_SUBCMD_SET_END);
 
 SHELL_STATIC_SUBCMD_SET_CREATE(
@@ -284,6 +1204,35 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
 		  "Print the chess board voltage offset from calibration value in millivolts",
 		  cmd_print_board_offset_voltage),
 	SHELL_CMD(calib, &calib_cmds, "Chess board calibration commands", NULL),
-	SHELL_CMD(monitor, &monitor, "Monitor chess board values", NULL), SHELL_SUBCMD_SET_END);
+	SHELL_CMD(monitor, &monitor, "Monitor chess board values in the background", NULL),
+	SHELL_CMD(stream, &stream_cmds, "Stream binary frames until 'q' is received", NULL),
+	SHELL_CMD(recorder, &recorder_cmds, "Flight recorder of the last frames and moves", NULL),
+	SHELL_CMD_ARG(idle, NULL, "Show scanner mode, idle and deadline statistics: idle [reset]",
+		      cmd_board_idle, 1, 1),
+	SHELL_CMD_ARG(stats, NULL,
+		      "Show scan phase timings, frame durations and error counts: stats [reset]",
+		      cmd_board_stats, 1, 1),
+	SHELL_CMD(boot, NULL, "Show the reset cause and when each boot phase was reached",
+		  cmd_board_boot),
+	SHELL_CMD_ARG(read, NULL, "Scan only the given squares and print them: read <square>...",
+		      cmd_board_read, 2, 63),
+	SHELL_CMD_ARG(filter, NULL,
+		      "Show or set the frame filter: filter [none | ema <shift 1-6> | "
+		      "median <3|5> | boxcar <2|4|8>]",
+		      cmd_board_filter, 1, 2),
+	SHELL_CMD(game, &game_cmds, "Game tracking commands", NULL),
+	SHELL_CMD(occupancy, NULL, "Print the occupancy bitboards, bit n is square n (A1 = 0)",
+		  cmd_board_occupancy),
+	SHELL_CMD_ARG(scanner, NULL, "Show or set the background scan period: scanner [period_ms]",
+		      cmd_board_scanner, 1, 1),
+	SHELL_CMD_ARG(profile, NULL,
+		      "Show or set the acquisition profile of active scans: "
+		      "profile [precise | fast | confirm]",
+		      cmd_board_profile, 1, 1),
+	SHELL_CMD_ARG(fps, NULL,
+		      "Measure full board scan rate, of the scanner thread with background: "
+		      "fps [frames] [async | background]",
+		      cmd_board_fps, 1, 2),
+	SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(board, &chess_cmds, "Chess board commands", NULL);
@@ -0,0 +1,297 @@
+#include "chessboard_detect.h"
+#include "chessboard_calibration.h"
+#include "chessboard_stats.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(chessboard_detect, LOG_LEVEL_INF);
+
+/* Raw counts, about -50 mV, 50 mV and 10 mV with a 3.3 V full scale at 12 bits */
+#define DETECT_DEFAULT_NEGATIVE_THRESHOLD (-62)
+#define DETECT_DEFAULT_POSITIVE_THRESHOLD 62
+#define DETECT_DEFAULT_HYSTERESIS         12
+
+static struct k_spinlock detect_lock;
+static struct chessboard_thresholds thresholds[CHESS_NUM_SQUARES] = {
+	[0 ... CHESS_NUM_SQUARES - 1] = {
+		.negative_raw = DETECT_DEFAULT_NEGATIVE_THRESHOLD,
+		.positive_raw = DETECT_DEFAULT_POSITIVE_THRESHOLD,
+		.hysteresis_raw = DETECT_DEFAULT_HYSTERESIS,
+	},
+};
+/* Also set when the thresholds changed */
+static bool reset_pending = true;
+/* Held while events are delivered, so a queue is never written after it was unsubscribed */
+static K_MUTEX_DEFINE(subscribers_lock);
+static struct k_msgq *subscribers[CHESSBOARD_DETECT_MAX_SUBSCRIBERS];
+static atomic_t dropped_events;
+
+ZBUS_CHAN_DEFINE(chessboard_event_chan, struct chessboard_event, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+		 ZBUS_MSG_INIT(0));
+
+/* Occupancy bitboards, bit n is CHESS_SQUARE() n. Squares in neither board are neutral once they
+ * are known, i.e. after the first frame following a reset.
+ */
+static struct chessboard_bitboards bitboards;
+static uint64_t known_squares;
+
+/* Only used by the scanner thread: the thresholds as of the last reset, so they are only copied
+ * when changed, and the offsets from calibration of the frame being processed
+ */
+static struct chessboard_thresholds active_thresholds[CHESS_NUM_SQUARES];
+static int16_t offsets[CHESS_NUM_SQUARES];
+
+int chessboard_detect_set_thresholds(int32_t negative_threshold, int32_t positive_threshold,
+				     uint16_t hysteresis)
+{
+	if ((positive_threshold <= negative_threshold) || (negative_threshold < INT16_MIN) ||
+	    (positive_threshold > INT16_MAX)) {
+		return -ERANGE;
+	}
+
+	K_SPINLOCK(&detect_lock) {
+		for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+			thresholds[square] = (struct chessboard_thresholds){
+				.negative_raw = (int16_t)negative_threshold,
+				.positive_raw = (int16_t)positive_threshold,
+				.hysteresis_raw = hysteresis,
+			};
+		}
+		reset_pending = true;
+	}
+	return 0;
+}
+
+int chessboard_detect_set_square_thresholds(
+	const struct chessboard_thresholds new_thresholds[CHESS_NUM_SQUARES])
+{
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		if (new_thresholds[square].positive_raw <= new_thresholds[square].negative_raw) {
+			return -ERANGE;
+		}
+	}
+
+	K_SPINLOCK(&detect_lock) {
+		memcpy(thresholds, new_thresholds, sizeof(thresholds));
+		reset_pending = true;
+	}
+	return 0;
+}
+
+void chessboard_detect_get_thresholds(uint8_t square, struct chessboard_thresholds *square_th)
+{
+	if (square >= CHESS_NUM_SQUARES) {
+		return;
+	}
+
+	K_SPINLOCK(&detect_lock) {
+		*square_th = thresholds[square];
+	}
+}
+
+static uint8_t square_state(uint64_t positive, uint64_t negative, uint64_t known, uint8_t square)
+{
+	const uint64_t bit = BIT64(square);
+
+	if (positive & bit) {
+		return CHESS_SQUARE_POSITIVE;
+	} else if (negative & bit) {
+		return CHESS_SQUARE_NEGATIVE;
+	} else if (known & bit) {
+		return CHESS_SQUARE_NEUTRAL;
+	}
+	return CHESS_SQUARE_UNKNOWN;
+}
+
+uint8_t chessboard_detect_get_state(uint8_t file, uint8_t rank)
+{
+	uint8_t state = CHESS_SQUARE_UNKNOWN;
+
+	if (file > 7 || rank > 7) {
+		return state;
+	}
+
+	K_SPINLOCK(&detect_lock) {
+		state = square_state(bitboards.positive, bitboards.negative, known_squares,
+				     CHESS_SQUARE(file, rank));
+	}
+	return state;
+}
+
+void chessboard_get_bitboards(struct chessboard_bitboards *bb)
+{
+	K_SPINLOCK(&detect_lock) {
+		*bb = bitboards;
+	}
+}
+
+int chessboard_detect_subscribe(struct k_msgq *queue)
+{
+	int ret = -ENOMEM;
+
+	k_mutex_lock(&subscribers_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+		if (subscribers[i] == NULL) {
+			subscribers[i] = queue;
+			ret = 0;
+			break;
+		}
+	}
+	k_mutex_unlock(&subscribers_lock);
+	return ret;
+}
+
+void chessboard_detect_unsubscribe(struct k_msgq *queue)
+{
+	k_mutex_lock(&subscribers_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+		if (subscribers[i] == queue) {
+			subscribers[i] = NULL;
+		}
+	}
+	k_mutex_unlock(&subscribers_lock);
+}
+
+uint32_t chessboard_detect_get_dropped(void)
+{
+	return (uint32_t)atomic_get(&dropped_events);
+}
+
+static void publish_event(const struct chessboard_event *event)
+{
+	/* A mutex, not detect_lock: copying into the queues does not need interrupts locked */
+	k_mutex_lock(&subscribers_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+		if ((subscribers[i] != NULL) &&
+		    (k_msgq_put(subscribers[i], event, K_NO_WAIT) != 0)) {
+			atomic_inc(&dropped_events);
+		}
+	}
+	k_mutex_unlock(&subscribers_lock);
+
+	/* Not with detect_lock held, the listeners run right here */
+	if (zbus_chan_pub(&chessboard_event_chan, event, K_NO_WAIT) != 0) {
+		atomic_inc(&dropped_events);
+	}
+}
+
+/* Shift the comparison result into bit 63, after all 64 squares bit n holds square n. Constant
+ * shifts only, a variable 64-bit shift is a library call on the Cortex-M0+.
+ */
+#define SHIFT_IN(mask, cond) (((mask) >> 1) | ((uint64_t)(cond) << 63))
+
+/* Classify every square from its offset and its previous state, squares not in @p known use the
+ * plain thresholds. Returns the new bitboards, changed includes every square that was not known.
+ */
+static struct chessboard_bitboards classify(const int16_t square_offsets[CHESS_NUM_SQUARES],
+					    const struct chessboard_thresholds *square_th,
+					    const struct chessboard_bitboards *previous,
+					    uint64_t known)
+{
+	uint64_t above[3] = {0}; /* > positive_low, > positive, > positive_high */
+	uint64_t below[3] = {0}; /* < negative_low, < negative, < negative_high */
+
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		const struct chessboard_thresholds *th = &square_th[square];
+		const int32_t offset = square_offsets[square];
+
+		above[0] = SHIFT_IN(above[0], offset > th->positive_raw - th->hysteresis_raw);
+		above[1] = SHIFT_IN(above[1], offset > th->positive_raw);
+		above[2] = SHIFT_IN(above[2], offset > th->positive_raw + th->hysteresis_raw);
+		below[0] = SHIFT_IN(below[0], offset < th->negative_raw - th->hysteresis_raw);
+		below[1] = SHIFT_IN(below[1], offset < th->negative_raw);
+		below[2] = SHIFT_IN(below[2], offset < th->negative_raw + th->hysteresis_raw);
+	}
+
+	/* The thresholds of every square depend on its previous state: a positive square has to
+	 * drop below positive - hysteresis to leave, a negative one rise above negative + hysteresis,
+	 * and a neutral one has to pass the outer bound of either threshold. Unknown squares use the
+	 * plain thresholds.
+	 */
+	const uint64_t positive = previous->positive & known;
+	const uint64_t negative = previous->negative & known;
+	const uint64_t neutral = known & ~positive & ~negative;
+	const uint64_t unknown = ~known;
+	struct chessboard_bitboards next;
+
+	next.positive = (positive & above[0]) | ((negative | neutral) & above[2]) |
+			(unknown & above[1]);
+	next.negative = ~next.positive & (((positive | neutral) & below[0]) |
+					  (negative & below[2]) | (unknown & below[1]));
+	next.changed = (next.positive ^ positive) | (next.negative ^ negative) | unknown;
+	return next;
+}
+
+void chessboard_detect_process(const struct chessboard_frame *frame)
+{
+	bool reset;
+
+	K_SPINLOCK(&detect_lock) {
+		reset = reset_pending;
+		reset_pending = false;
+		if (reset) {
+			memcpy(active_thresholds, thresholds, sizeof(active_thresholds));
+		}
+	}
+
+	const int16_t *calibration = chessboard_calibration_get_offsets();
+	const uint32_t start = k_cycle_get_32();
+
+	/* Both in raw counts, at most 2 * 4095 apart */
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		offsets[square] = calibration[square] - frame->raw[square];
+	}
+	chessboard_stats_add(CHESSBOARD_STATS_PHASE_CALIBRATION, start, CHESS_NUM_SQUARES);
+
+	const uint64_t known = reset ? 0 : known_squares;
+	const uint64_t positive = bitboards.positive & known;
+	const uint64_t negative = bitboards.negative & known;
+	const struct chessboard_bitboards next =
+		classify(offsets, active_thresholds, &bitboards, known);
+	uint64_t changed = next.changed;
+
+	K_SPINLOCK(&detect_lock) {
+		bitboards = next;
+		known_squares = ~(uint64_t)0;
+	}
+
+	while (changed != 0) {
+		const uint8_t square = (uint8_t)__builtin_ctzll(changed);
+		const struct chessboard_event event = {
+			.timestamp_ms = frame->timestamp_ms,
+			.offset_raw = offsets[square],
+			.square = square,
+			.old_state = square_state(positive, negative, known, square),
+			.new_state =
+				square_state(next.positive, next.negative, ~(uint64_t)0, square),
+		};
+
+		publish_event(&event);
+		changed &= changed - 1;
+	}
+}
+
+uint64_t chessboard_detect_get_uncertain(const int16_t raw[CHESS_NUM_SQUARES], uint64_t mask,
+					 const uint16_t margin[CHESS_NUM_SQUARES])
+{
+	const int16_t *calibration = chessboard_calibration_get_offsets();
+	uint64_t uncertain = 0;
+
+	while (mask != 0) {
+		const uint8_t square = (uint8_t)__builtin_ctzll(mask);
+		const struct chessboard_thresholds *th = &active_thresholds[square];
+		const int32_t offset = calibration[square] - raw[square];
+		const int32_t band = th->hysteresis_raw + margin[square];
+
+		if ((ABS(offset - th->positive_raw) <= band) ||
+		    (ABS(offset - th->negative_raw) <= band)) {
+			uncertain |= BIT64(square);
+		}
+		mask &= mask - 1;
+	}
+	return uncertain;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <zephyr/zbus/zbus.h>
+
+#include "chessboard_scanner.h"
+
+#define CHESS_SQUARE_NEGATIVE ((uint8_t)0u)
+#define CHESS_SQUARE_POSITIVE ((uint8_t)1u)
+#define CHESS_SQUARE_NEUTRAL  ((uint8_t)2u)
+#define CHESS_SQUARE_UNKNOWN  ((uint8_t)3u)
+
+/* Maximum number of event queues that can be subscribed at the same time */
+#define CHESSBOARD_DETECT_MAX_SUBSCRIBERS 4
+/* Events published for a single frame at most: after a reset every square reports its state.
+ * Subscribed queues hold at least this many, or they miss part of the board.
+ */
+#define CHESSBOARD_DETECT_MAX_BURST       CHESS_NUM_SQUARES
+
+/* A square crossed a threshold */
+struct chessboard_event {
+	/* Timestamp of the frame the change was detected in */
+	uint32_t timestamp_ms;
+	/* Offset from calibration in raw counts */
+	int16_t offset_raw;
+	/* CHESS_SQUARE() index */
+	uint8_t square;
+	uint8_t old_state;
+	uint8_t new_state;
+};
+
+/*
+ * Every event, published in the scanner thread while a frame is processed. Observers read it in
+ * place, see chessboard_frame_chan. An event that cannot be published is counted as dropped.
+ */
+ZBUS_CHAN_DECLARE(chessboard_event_chan);
+
+/* Offset thresholds of one square in raw counts, see chessboard_mv_to_raw(). A square turns
+ * positive above positive_raw and negative below negative_raw, and has to move back hysteresis_raw
+ * past the threshold to leave that state again.
+ */
+struct chessboard_thresholds {
+	int16_t negative_raw;
+	int16_t positive_raw;
+	uint16_t hysteresis_raw;
+};
+
+/**
+ * Set the same offset thresholds, in raw counts, for all squares. All squares restart in
+ * CHESS_SQUARE_UNKNOWN, so subscribers receive the state of every square again on the next frame.
+ */
+int chessboard_detect_set_thresholds(int32_t negative_threshold, int32_t positive_threshold,
+				     uint16_t hysteresis);
+
+/**
+ * Set individual thresholds for every square, e.g. derived from the noise measured during
+ * calibration. All squares restart in CHESS_SQUARE_UNKNOWN as well.
+ *
+ * @return 0 on success, -ERANGE if a positive threshold is not above its negative one.
+ */
+int chessboard_detect_set_square_thresholds(
+	const struct chessboard_thresholds thresholds[CHESS_NUM_SQUARES]);
+void chessboard_detect_get_thresholds(uint8_t square, struct chessboard_thresholds *thresholds);
+
+/* Occupancy of the board as of the latest frame, bit n is CHESS_SQUARE() n */
+struct chessboard_bitboards {
+	/* Squares in CHESS_SQUARE_POSITIVE state */
+	uint64_t positive;
+	/* Squares in CHESS_SQUARE_NEGATIVE state */
+	uint64_t negative;
+	/* Squares whose state changed compared to the previous frame */
+	uint64_t changed;
+};
+
+uint8_t chessboard_detect_get_state(uint8_t file, uint8_t rank);
+void chessboard_get_bitboards(struct chessboard_bitboards *bb);
+
+/**
+ * Subscribe a message queue of struct chessboard_event, of CHESSBOARD_DETECT_MAX_BURST entries
+ * or more. Every subscriber receives every event; events that do not fit in a full queue are
+ * dropped and counted.
+ *
+ * @return 0 on success, -ENOMEM if all subscriber slots are taken.
+ */
+int chessboard_detect_subscribe(struct k_msgq *queue);
+void chessboard_detect_unsubscribe(struct k_msgq *queue);
+uint32_t chessboard_detect_get_dropped(void);
+
+/* Run the detection engine on a new frame, called by the scanner for every published frame */
+void chessboard_detect_process(const struct chessboard_frame *frame);
+
+/**
+ * Squares of @p mask whose offset from calibration in @p raw, unfiltered counts, is within their
+ * entry of @p margin counts of one of their hysteresis bands, so a noisy reading may decide their
+ * state wrongly. Uses the thresholds of the last processed frame, only called by the scanner
+ * thread.
+ */
+uint64_t chessboard_detect_get_uncertain(const int16_t raw[CHESS_NUM_SQUARES], uint64_t mask,
+					 const uint16_t margin[CHESS_NUM_SQUARES]);
@@ -0,0 +1,217 @@
+#include "chessboard_filter.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(chessboard_filter, LOG_LEVEL_INF);
+
+/* Fraction bits of the EMA state, keeps small steps from being lost to truncation */
+#define FILTER_EMA_FRACTION_BITS 8
+
+#define FILTER_HISTORY_DEPTH                                                                       \
+	MAX(CHESSBOARD_FILTER_MEDIAN_MAX_WINDOW, CHESSBOARD_FILTER_BOXCAR_MAX_WINDOW)
+
+#define FILTER_DEFAULT_KIND  CHESSBOARD_FILTER_EMA
+#define FILTER_DEFAULT_PARAM 2
+
+struct filter_config {
+	uint8_t kind;
+	uint8_t param;
+};
+
+/* Struct of arrays over the squares, so each pass walks contiguous arrays for the whole board.
+ * The scanner does not acquire every square for every frame, so each square has its own position
+ * in the history ring.
+ */
+struct filter_state {
+	int32_t ema[CHESS_NUM_SQUARES];
+	int32_t sum[CHESS_NUM_SQUARES];
+	int16_t history[FILTER_HISTORY_DEPTH][CHESS_NUM_SQUARES];
+	/* Last filtered value, repeated for squares that were not acquired */
+	int16_t output[CHESS_NUM_SQUARES];
+	uint8_t head[CHESS_NUM_SQUARES];
+	/* Number of samples in the filter, 0 until the first sample after a restart */
+	uint8_t count[CHESS_NUM_SQUARES];
+};
+
+static struct k_spinlock filter_lock;
+static struct filter_config config = {
+	.kind = FILTER_DEFAULT_KIND,
+	.param = FILTER_DEFAULT_PARAM,
+};
+static bool restart_pending = true;
+
+/* Only used by the scanner thread */
+static struct filter_state state;
+
+static bool is_power_of_two(uint8_t value)
+{
+	return (value != 0) && ((value & (value - 1)) == 0);
+}
+
+int chessboard_filter_configure(uint8_t kind, uint8_t param)
+{
+	switch (kind) {
+	case CHESSBOARD_FILTER_NONE:
+		param = 0;
+		break;
+	case CHESSBOARD_FILTER_EMA:
+		if (param < 1 || param > CHESSBOARD_FILTER_EMA_MAX_SHIFT) {
+			return -EINVAL;
+		}
+		break;
+	case CHESSBOARD_FILTER_MEDIAN:
+		if ((param & 1) == 0 || param < CHESSBOARD_FILTER_MEDIAN_MIN_WINDOW ||
+		    param > CHESSBOARD_FILTER_MEDIAN_MAX_WINDOW) {
+			return -EINVAL;
+		}
+		break;
+	case CHESSBOARD_FILTER_BOXCAR:
+		if (!is_power_of_two(param) || param > CHESSBOARD_FILTER_BOXCAR_MAX_WINDOW) {
+			return -EINVAL;
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	K_SPINLOCK(&filter_lock) {
+		config.kind = kind;
+		config.param = param;
+		restart_pending = true;
+	}
+	return 0;
+}
+
+void chessboard_filter_get_config(uint8_t *kind, uint8_t *param)
+{
+	K_SPINLOCK(&filter_lock) {
+		*kind = config.kind;
+		*param = config.param;
+	}
+}
+
+static int32_t filter_ema(uint8_t square, int32_t raw, uint8_t shift)
+{
+	if (state.count[square] == 0) {
+		/* Samples of inverted files are negative, a left shift of those is undefined */
+		state.ema[square] = raw * (int32_t)BIT(FILTER_EMA_FRACTION_BITS);
+		state.count[square] = 1;
+		return raw;
+	}
+
+	state.ema[square] += ((raw * (int32_t)BIT(FILTER_EMA_FRACTION_BITS)) - state.ema[square]) >>
+			     shift;
+	return (state.ema[square] + BIT(FILTER_EMA_FRACTION_BITS - 1)) >> FILTER_EMA_FRACTION_BITS;
+}
+
+/* Store the sample as the newest history entry of the square, returns the number of entries */
+static uint8_t push_history(uint8_t square, int16_t raw, uint8_t window)
+{
+	state.head[square] = (state.head[square] + 1) % window;
+	state.history[state.head[square]][square] = raw;
+
+	if (state.count[square] < window) {
+		state.count[square]++;
+	}
+	return state.count[square];
+}
+
+static int32_t filter_median(uint8_t square, int16_t raw, uint8_t window)
+{
+	int16_t sorted[CHESSBOARD_FILTER_MEDIAN_MAX_WINDOW];
+
+	if (push_history(square, raw, window) < window) {
+		/* Not enough samples yet, pass through */
+		return raw;
+	}
+
+	/* Insertion sort, at most 5 elements */
+	for (int n = 0; n < window; n++) {
+		const int16_t value = state.history[n][square];
+		int k = n;
+
+		for (; k > 0 && sorted[k - 1] > value; k--) {
+			sorted[k] = sorted[k - 1];
+		}
+		sorted[k] = value;
+	}
+	return sorted[window / 2];
+}
+
+static int32_t filter_boxcar(uint8_t square, int16_t raw, uint8_t window)
+{
+	if (state.count[square] == window) {
+		/* The oldest entry is about to be overwritten by the new sample */
+		state.sum[square] -= state.history[(state.head[square] + 1) % window][square];
+	} else if (state.count[square] == 0) {
+		state.sum[square] = 0;
+	}
+
+	push_history(square, raw, window);
+	state.sum[square] += raw;
+
+	if (state.count[square] < window) {
+		/* Not enough samples yet, pass through */
+		return raw;
+	}
+
+	return (state.sum[square] + (window / 2)) >> __builtin_ctz(window);
+}
+
+void chessboard_filter_apply(int16_t raw[CHESS_NUM_SQUARES], uint64_t scanned,
+			     uint64_t unfiltered)
+{
+	struct filter_config cfg;
+	bool restart;
+
+	K_SPINLOCK(&filter_lock) {
+		cfg = config;
+		restart = restart_pending;
+		restart_pending = false;
+	}
+
+	if (restart) {
+		memset(state.head, 0, sizeof(state.head));
+		memset(state.count, 0, sizeof(state.count));
+	}
+
+	if (cfg.kind == CHESSBOARD_FILTER_NONE) {
+		return;
+	}
+
+	/* Constant shifts of the mask only, as in SHIFT_IN() of chessboard_detect.c */
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES;
+	     square++, scanned >>= 1, unfiltered >>= 1) {
+		if ((scanned & 1) == 0) {
+			if (state.count[square] > 0) {
+				raw[square] = state.output[square];
+			}
+			continue;
+		}
+
+		if (unfiltered & 1) {
+			/* Passed through, the history starts over with the next filtered sample */
+			state.count[square] = 0;
+			state.output[square] = raw[square];
+			continue;
+		}
+
+		switch (cfg.kind) {
+		case CHESSBOARD_FILTER_EMA:
+			raw[square] = (int16_t)filter_ema(square, raw[square], cfg.param);
+			break;
+		case CHESSBOARD_FILTER_MEDIAN:
+			raw[square] = (int16_t)filter_median(square, raw[square], cfg.param);
+			break;
+		case CHESSBOARD_FILTER_BOXCAR:
+			raw[square] = (int16_t)filter_boxcar(square, raw[square], cfg.param);
+			break;
+		default:
+			break;
+		}
+		state.output[square] = raw[square];
+	}
+}
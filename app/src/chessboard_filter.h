@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "chessboard.h"
+
+/*
+ * Per square filtering of the scanned raw counts, applied by the scanner to every frame before it
+ * is published and passed on to detection. Integer only: the Cortex-M0+ has neither an FPU nor a
+ * divide instruction, so all averaging is done with power of two windows and shifts.
+ */
+
+/* Pass the samples through unchanged */
+#define CHESSBOARD_FILTER_NONE   ((uint8_t)0u)
+/* Exponential moving average, y += (x - y) / 2^param */
+#define CHESSBOARD_FILTER_EMA    ((uint8_t)1u)
+/* Median of the last param samples, param 3 or 5 */
+#define CHESSBOARD_FILTER_MEDIAN ((uint8_t)2u)
+/* Mean of the last param samples, param a power of two */
+#define CHESSBOARD_FILTER_BOXCAR ((uint8_t)3u)
+
+#define CHESSBOARD_FILTER_EMA_MAX_SHIFT     6
+#define CHESSBOARD_FILTER_MEDIAN_MIN_WINDOW 3
+#define CHESSBOARD_FILTER_MEDIAN_MAX_WINDOW 5
+#define CHESSBOARD_FILTER_BOXCAR_MAX_WINDOW 8
+
+/**
+ * Select the filter. The filter restarts from the next frame.
+ *
+ * @return 0 on success, -EINVAL if the parameter is not valid for the filter kind.
+ */
+int chessboard_filter_configure(uint8_t kind, uint8_t param);
+void chessboard_filter_get_config(uint8_t *kind, uint8_t *param);
+
+/**
+ * Filter a frame in place, called by the scanner for every frame. Only the squares in @p scanned
+ * take a new sample, the others repeat their previous filtered value.
+ *
+ * Squares in @p unfiltered were acquired with another acquisition setting than their history,
+ * e.g. by an idle sentinel scan. Their sample is passed through as is, so a change shows in the
+ * same frame, and their filter restarts with the next sample instead of mixing both settings.
+ */
+void chessboard_filter_apply(int16_t raw[CHESS_NUM_SQUARES], uint64_t scanned,
+			     uint64_t unfiltered);
@@ -0,0 +1,709 @@
+#include "chessboard_game.h"
+#include "chessboard_boot.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/linker/section_tags.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(chessboard_game, LOG_LEVEL_INF);
+
+/* A changed occupancy has to be stable this long before it is matched against the legal moves */
+#define GAME_SETTLE_MS     300
+/* A position that is on the way to a legal move, e.g. the king moved but not yet the rook when
+ * castling, is only reported as illegal after this long
+ */
+#define GAME_INCOMPLETE_MS 3000
+
+#define WHITE 0
+#define BLACK 1
+
+#define CASTLE_WHITE_KING  ((uint8_t)0x01u)
+#define CASTLE_WHITE_QUEEN ((uint8_t)0x02u)
+#define CASTLE_BLACK_KING  ((uint8_t)0x04u)
+#define CASTLE_BLACK_QUEEN ((uint8_t)0x08u)
+
+#define START_OCCUPANCY_WHITE 0x000000000000FFFFull
+#define START_OCCUPANCY_BLACK 0xFFFF000000000000ull
+
+#define SNAPSHOT_MAGIC 0x43485353u
+
+struct game_position {
+	uint8_t board[CHESS_NUM_SQUARES];
+	uint64_t occupancy[2];
+	uint8_t king[2];
+	uint8_t side;
+	uint8_t castling;
+	uint8_t ep_square;
+	uint16_t ply;
+};
+
+struct game_move {
+	uint8_t from;
+	uint8_t to;
+	uint8_t promotion;
+	uint8_t flags;
+};
+
+typedef void (*move_visitor_t)(const struct game_move *move, const struct game_position *result,
+			       void *user_data);
+
+/* The position of the game in progress, in RAM that is not cleared at boot. After a warm reset,
+ * e.g. by the watchdog, the game is resumed from it as soon as the board shows the same occupancy,
+ * instead of waiting for the pieces to be set up again.
+ */
+struct game_snapshot {
+	uint32_t magic;
+	struct game_position position;
+	uint32_t crc;
+};
+
+enum observation_state {
+	/* Not evaluated yet, waiting for the occupancy to settle */
+	OBSERVATION_NEW,
+	/* On the way to a legal move, waiting for it to complete */
+	OBSERVATION_INCOMPLETE,
+	/* Evaluated, nothing to do until the occupancy changes */
+	OBSERVATION_DONE,
+};
+
+static const int8_t knight_steps[8][2] = {
+	{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2},
+};
+
+/* Orthogonal directions first, diagonal directions last */
+static const int8_t directions[8][2] = {
+	{1, 0}, {0, 1}, {-1, 0}, {0, -1}, {1, 1}, {-1, 1}, {-1, -1}, {1, -1},
+};
+
+static const uint8_t back_rank[8] = {
+	CHESS_PIECE_ROOK, CHESS_PIECE_KNIGHT, CHESS_PIECE_BISHOP, CHESS_PIECE_QUEEN,
+	CHESS_PIECE_KING, CHESS_PIECE_BISHOP, CHESS_PIECE_KNIGHT, CHESS_PIECE_ROOK,
+};
+
+static struct k_spinlock game_lock;
+static struct k_msgq *subscribers[CHESSBOARD_GAME_MAX_SUBSCRIBERS];
+static atomic_t new_game_pending;
+static atomic_t resume_pending = ATOMIC_INIT(1);
+static __noinit struct game_snapshot snapshot;
+
+/* Only written by the scanner thread, under game_lock */
+static struct game_position position;
+static bool synced;
+
+/* Only used by the scanner thread */
+static uint64_t observed[2];
+static uint32_t observed_since_ms;
+static enum observation_state observation;
+
+static inline uint8_t make_piece(uint8_t type, uint8_t colour)
+{
+	return (colour == BLACK) ? (type | CHESS_PIECE_BLACK) : type;
+}
+
+static inline bool is_colour(uint8_t piece, uint8_t colour)
+{
+	return (piece != CHESS_PIECE_NONE) && (((piece & CHESS_PIECE_BLACK) != 0) == (colour == BLACK));
+}
+
+static int offset_square(uint8_t square, int file_step, int rank_step)
+{
+	const int file = (square % CHESS_NUM_FILES) + file_step;
+	const int rank = (square / CHESS_NUM_FILES) + rank_step;
+
+	if (file < 0 || file >= CHESS_NUM_FILES || rank < 0 || rank >= CHESS_NUM_RANKS) {
+		return -1;
+	}
+	return CHESS_SQUARE(file, rank);
+}
+
+static void set_start_position(struct game_position *pos)
+{
+	memset(pos, 0, sizeof(*pos));
+
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		pos->board[CHESS_SQUARE(file, 0)] = make_piece(back_rank[file], WHITE);
+		pos->board[CHESS_SQUARE(file, 1)] = make_piece(CHESS_PIECE_PAWN, WHITE);
+		pos->board[CHESS_SQUARE(file, 6)] = make_piece(CHESS_PIECE_PAWN, BLACK);
+		pos->board[CHESS_SQUARE(file, 7)] = make_piece(back_rank[file], BLACK);
+	}
+
+	pos->occupancy[WHITE] = START_OCCUPANCY_WHITE;
+	pos->occupancy[BLACK] = START_OCCUPANCY_BLACK;
+	pos->king[WHITE] = CHESS_SQUARE(4, 0);
+	pos->king[BLACK] = CHESS_SQUARE(4, 7);
+	pos->side = WHITE;
+	pos->castling = CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN | CASTLE_BLACK_KING |
+			CASTLE_BLACK_QUEEN;
+	pos->ep_square = CHESS_MOVE_NO_SQUARE;
+}
+
+static bool is_attacked(const struct game_position *pos, uint8_t square, uint8_t by)
+{
+	/* A pawn attacks the square from one rank behind, seen from the attacker */
+	const int pawn_rank_step = (by == WHITE) ? -1 : 1;
+
+	for (int file_step = -1; file_step <= 1; file_step += 2) {
+		const int from = offset_square(square, file_step, pawn_rank_step);
+
+		if (from >= 0 && pos->board[from] == make_piece(CHESS_PIECE_PAWN, by)) {
+			return true;
+		}
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(knight_steps); i++) {
+		const int from = offset_square(square, knight_steps[i][0], knight_steps[i][1]);
+
+		if (from >= 0 && pos->board[from] == make_piece(CHESS_PIECE_KNIGHT, by)) {
+			return true;
+		}
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(directions); i++) {
+		const uint8_t slider = (i < 4) ? CHESS_PIECE_ROOK : CHESS_PIECE_BISHOP;
+		int from = offset_square(square, directions[i][0], directions[i][1]);
+
+		if (from >= 0 && pos->board[from] == make_piece(CHESS_PIECE_KING, by)) {
+			return true;
+		}
+
+		for (; from >= 0; from = offset_square(from, directions[i][0], directions[i][1])) {
+			const uint8_t piece = pos->board[from];
+
+			if (piece == CHESS_PIECE_NONE) {
+				continue;
+			}
+			if (piece == make_piece(slider, by) ||
+			    piece == make_piece(CHESS_PIECE_QUEEN, by)) {
+				return true;
+			}
+			break;
+		}
+	}
+
+	return false;
+}
+
+static uint8_t castling_rights_lost(uint8_t square)
+{
+	switch (square) {
+	case CHESS_SQUARE(0, 0):
+		return CASTLE_WHITE_QUEEN;
+	case CHESS_SQUARE(7, 0):
+		return CASTLE_WHITE_KING;
+	case CHESS_SQUARE(0, 7):
+		return CASTLE_BLACK_QUEEN;
+	case CHESS_SQUARE(7, 7):
+		return CASTLE_BLACK_KING;
+	default:
+		return 0;
+	}
+}
+
+static void move_piece(struct game_position *pos, uint8_t from, uint8_t to, uint8_t piece)
+{
+	const uint8_t colour = pos->side;
+
+	pos->board[from] = CHESS_PIECE_NONE;
+	pos->board[to] = piece;
+	pos->occupancy[colour] = (pos->occupancy[colour] & ~BIT64(from)) | BIT64(to);
+}
+
+static void apply_move(struct game_position *pos, const struct game_move *move)
+{
+	const uint8_t us = pos->side;
+	const uint8_t them = us ^ 1;
+	const uint8_t piece = pos->board[move->from];
+	uint8_t captured_square = move->to;
+
+	if (move->flags & CHESS_MOVE_EN_PASSANT) {
+		captured_square = CHESS_SQUARE(move->to % CHESS_NUM_FILES,
+					       move->from / CHESS_NUM_FILES);
+	}
+	if (pos->board[captured_square] != CHESS_PIECE_NONE) {
+		pos->board[captured_square] = CHESS_PIECE_NONE;
+		pos->occupancy[them] &= ~BIT64(captured_square);
+	}
+
+	move_piece(pos, move->from, move->to,
+		   (move->flags & CHESS_MOVE_PROMOTION) ? make_piece(move->promotion, us) : piece);
+
+	if (move->flags & CHESS_MOVE_CASTLE) {
+		const uint8_t rank_base = move->from - (move->from % CHESS_NUM_FILES);
+		const bool king_side = (move->to % CHESS_NUM_FILES) == 6;
+		const uint8_t rook_from = rank_base + (king_side ? 7 : 0);
+		const uint8_t rook_to = rank_base + (king_side ? 5 : 3);
+
+		move_piece(pos, rook_from, rook_to, pos->board[rook_from]);
+	}
+
+	if ((piece & CHESS_PIECE_TYPE_MASK) == CHESS_PIECE_KING) {
+		pos->king[us] = move->to;
+		pos->castling &= (us == WHITE) ? ~(CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN)
+					       : ~(CASTLE_BLACK_KING | CASTLE_BLACK_QUEEN);
+	}
+	pos->castling &= ~(castling_rights_lost(move->from) | castling_rights_lost(move->to));
+
+	if ((piece & CHESS_PIECE_TYPE_MASK) == CHESS_PIECE_PAWN &&
+	    (move->to == move->from + 16 || move->from == move->to + 16)) {
+		pos->ep_square = (move->from + move->to) / 2;
+	} else {
+		pos->ep_square = CHESS_MOVE_NO_SQUARE;
+	}
+
+	pos->side = them;
+	pos->ply++;
+}
+
+static void try_move(const struct game_position *pos, uint8_t from, uint8_t to, uint8_t promotion,
+		     uint8_t flags, move_visitor_t visit, void *user_data)
+{
+	struct game_move move = {
+		.from = from,
+		.to = to,
+		.promotion = promotion,
+		.flags = flags,
+	};
+	struct game_position next = *pos;
+
+	apply_move(&next, &move);
+
+	if (is_attacked(&next, next.king[pos->side], next.side)) {
+		return;
+	}
+	if (is_attacked(&next, next.king[next.side], pos->side)) {
+		move.flags |= CHESS_MOVE_CHECK;
+	}
+
+	visit(&move, &next, user_data);
+}
+
+static void try_pawn_move(const struct game_position *pos, uint8_t from, uint8_t to, uint8_t flags,
+			  move_visitor_t visit, void *user_data)
+{
+	static const uint8_t promotions[] = {
+		CHESS_PIECE_QUEEN, CHESS_PIECE_ROOK, CHESS_PIECE_BISHOP, CHESS_PIECE_KNIGHT,
+	};
+	const uint8_t rank = to / CHESS_NUM_FILES;
+
+	if (rank != 0 && rank != CHESS_NUM_RANKS - 1) {
+		try_move(pos, from, to, CHESS_PIECE_NONE, flags, visit, user_data);
+		return;
+	}
+
+	/* Queen first, it is the default when several promotions match */
+	for (int i = 0; i < ARRAY_SIZE(promotions); i++) {
+		try_move(pos, from, to, promotions[i], flags | CHESS_MOVE_PROMOTION, visit,
+			 user_data);
+	}
+}
+
+static void generate_pawn_moves(const struct game_position *pos, uint8_t from,
+				move_visitor_t visit, void *user_data)
+{
+	const uint8_t us = pos->side;
+	const int forward = (us == WHITE) ? 1 : -1;
+	const uint8_t start_rank = (us == WHITE) ? 1 : 6;
+	int to = offset_square(from, 0, forward);
+
+	if (to >= 0 && pos->board[to] == CHESS_PIECE_NONE) {
+		try_pawn_move(pos, from, to, 0, visit, user_data);
+
+		if ((from / CHESS_NUM_FILES) == start_rank) {
+			to = offset_square(from, 0, 2 * forward);
+			if (pos->board[to] == CHESS_PIECE_NONE) {
+				try_move(pos, from, to, CHESS_PIECE_NONE, 0, visit, user_data);
+			}
+		}
+	}
+
+	for (int file_step = -1; file_step <= 1; file_step += 2) {
+		to = offset_square(from, file_step, forward);
+
+		if (to < 0) {
+			continue;
+		}
+		if (is_colour(pos->board[to], us ^ 1)) {
+			try_pawn_move(pos, from, to, CHESS_MOVE_CAPTURE, visit, user_data);
+		} else if (to == pos->ep_square) {
+			try_move(pos, from, to, CHESS_PIECE_NONE,
+				 CHESS_MOVE_CAPTURE | CHESS_MOVE_EN_PASSANT, visit, user_data);
+		}
+	}
+}
+
+static void generate_steps(const struct game_position *pos, uint8_t from,
+			   const int8_t (*steps)[2], size_t num_steps, bool slide,
+			   move_visitor_t visit, void *user_data)
+{
+	const uint8_t us = pos->side;
+
+	for (size_t i = 0; i < num_steps; i++) {
+		int to = offset_square(from, steps[i][0], steps[i][1]);
+
+		for (; to >= 0; to = offset_square(to, steps[i][0], steps[i][1])) {
+			const uint8_t piece = pos->board[to];
+
+			if (piece == CHESS_PIECE_NONE) {
+				try_move(pos, from, to, CHESS_PIECE_NONE, 0, visit, user_data);
+			} else {
+				if (!is_colour(piece, us)) {
+					try_move(pos, from, to, CHESS_PIECE_NONE,
+						 CHESS_MOVE_CAPTURE, visit, user_data);
+				}
+				break;
+			}
+
+			if (!slide) {
+				break;
+			}
+		}
+	}
+}
+
+static void generate_castling(const struct game_position *pos, move_visitor_t visit,
+			      void *user_data)
+{
+	const uint8_t us = pos->side;
+	const uint8_t them = us ^ 1;
+	const uint8_t base = (us == WHITE) ? CHESS_SQUARE(0, 0) : CHESS_SQUARE(0, 7);
+	const uint8_t king_side = (us == WHITE) ? CASTLE_WHITE_KING : CASTLE_BLACK_KING;
+	const uint8_t queen_side = (us == WHITE) ? CASTLE_WHITE_QUEEN : CASTLE_BLACK_QUEEN;
+	const uint8_t rook = make_piece(CHESS_PIECE_ROOK, us);
+	const uint8_t *board = pos->board;
+
+	if (pos->king[us] != base + 4 || is_attacked(pos, base + 4, them)) {
+		return;
+	}
+
+	if ((pos->castling & king_side) && board[base + 7] == rook &&
+	    board[base + 5] == CHESS_PIECE_NONE && board[base + 6] == CHESS_PIECE_NONE &&
+	    !is_attacked(pos, base + 5, them)) {
+		/* The destination square is checked by try_move() */
+		try_move(pos, base + 4, base + 6, CHESS_PIECE_NONE, CHESS_MOVE_CASTLE, visit,
+			 user_data);
+	}
+
+	if ((pos->castling & queen_side) && board[base] == rook &&
+	    board[base + 1] == CHESS_PIECE_NONE && board[base + 2] == CHESS_PIECE_NONE &&
+	    board[base + 3] == CHESS_PIECE_NONE && !is_attacked(pos, base + 3, them)) {
+		try_move(pos, base + 4, base + 2, CHESS_PIECE_NONE, CHESS_MOVE_CASTLE, visit,
+			 user_data);
+	}
+}
+
+/* Call visit() for every legal move of the side to move, with the position it leads to */
+static void generate_moves(const struct game_position *pos, move_visitor_t visit, void *user_data)
+{
+	for (uint8_t from = 0; from < CHESS_NUM_SQUARES; from++) {
+		const uint8_t piece = pos->board[from];
+
+		if (!is_colour(piece, pos->side)) {
+			continue;
+		}
+
+		switch (piece & CHESS_PIECE_TYPE_MASK) {
+		case CHESS_PIECE_PAWN:
+			generate_pawn_moves(pos, from, visit, user_data);
+			break;
+		case CHESS_PIECE_KNIGHT:
+			generate_steps(pos, from, knight_steps, 8, false, visit, user_data);
+			break;
+		case CHESS_PIECE_BISHOP:
+			generate_steps(pos, from, &directions[4], 4, true, visit, user_data);
+			break;
+		case CHESS_PIECE_ROOK:
+			generate_steps(pos, from, directions, 4, true, visit, user_data);
+			break;
+		case CHESS_PIECE_QUEEN:
+			generate_steps(pos, from, directions, 8, true, visit, user_data);
+			break;
+		case CHESS_PIECE_KING:
+			generate_steps(pos, from, directions, 8, false, visit, user_data);
+			generate_castling(pos, visit, user_data);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+struct move_match {
+	uint64_t observed[2];
+	uint64_t current[2];
+	uint8_t matches;
+	/* The observed occupancy is part of the way to at least one legal move */
+	bool incomplete;
+	struct game_move move;
+	struct game_position result;
+};
+
+static void match_move(const struct game_move *move, const struct game_position *result,
+		       void *user_data)
+{
+	struct move_match *match = user_data;
+
+	if (result->occupancy[WHITE] == match->observed[WHITE] &&
+	    result->occupancy[BLACK] == match->observed[BLACK]) {
+		/* Promotions to different pieces look the same, the first one is the queen */
+		if (match->matches == 0 || match->move.from != move->from ||
+		    match->move.to != move->to) {
+			if (match->matches++ == 0) {
+				match->move = *move;
+				match->result = *result;
+			}
+		}
+		return;
+	}
+
+	for (int colour = WHITE; colour <= BLACK; colour++) {
+		const uint64_t observed_change = match->observed[colour] ^ match->current[colour];
+		const uint64_t move_change = result->occupancy[colour] ^ match->current[colour];
+
+		if (observed_change & ~move_change) {
+			return;
+		}
+	}
+	match->incomplete = true;
+}
+
+void chessboard_game_new(void)
+{
+	atomic_clear(&resume_pending);
+	atomic_set(&new_game_pending, 1);
+}
+
+int chessboard_game_get_position(uint8_t board[CHESS_NUM_SQUARES], bool *black_to_move,
+				 uint16_t *ply)
+{
+	int ret = -EAGAIN;
+
+	K_SPINLOCK(&game_lock) {
+		if (synced) {
+			memcpy(board, position.board, CHESS_NUM_SQUARES);
+			*black_to_move = position.side == BLACK;
+			*ply = position.ply;
+			ret = 0;
+		}
+	}
+	return ret;
+}
+
+int chessboard_game_subscribe(struct k_msgq *queue)
+{
+	int ret = -ENOMEM;
+
+	K_SPINLOCK(&game_lock) {
+		for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+			if (subscribers[i] == NULL) {
+				subscribers[i] = queue;
+				ret = 0;
+				break;
+			}
+		}
+	}
+	return ret;
+}
+
+void chessboard_game_unsubscribe(struct k_msgq *queue)
+{
+	K_SPINLOCK(&game_lock) {
+		for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+			if (subscribers[i] == queue) {
+				subscribers[i] = NULL;
+			}
+		}
+	}
+}
+
+static void publish_move(const struct chessboard_move *move)
+{
+	K_SPINLOCK(&game_lock) {
+		for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+			if ((subscribers[i] != NULL) &&
+			    (k_msgq_put(subscribers[i], move, K_NO_WAIT) != 0)) {
+				LOG_WRN("Move queue full, move dropped");
+			}
+		}
+	}
+}
+
+static void publish_rejection(uint8_t flags, uint32_t timestamp_ms)
+{
+	const struct chessboard_move record = {
+		.timestamp_ms = timestamp_ms,
+		.ply = position.ply,
+		.from = CHESS_MOVE_NO_SQUARE,
+		.to = CHESS_MOVE_NO_SQUARE,
+		.flags = flags,
+	};
+
+	publish_move(&record);
+}
+
+static uint32_t snapshot_crc(void)
+{
+	return crc32_ieee((const uint8_t *)&snapshot.position, sizeof(snapshot.position));
+}
+
+static void save_snapshot(void)
+{
+	snapshot.position = position;
+	snapshot.crc = snapshot_crc();
+	snapshot.magic = SNAPSHOT_MAGIC;
+}
+
+static void accept_move(const struct move_match *match, uint32_t timestamp_ms)
+{
+	const struct game_move *move = &match->move;
+	struct chessboard_move record = {
+		.timestamp_ms = timestamp_ms,
+		.ply = position.ply,
+		.from = move->from,
+		.to = move->to,
+		.piece = position.board[move->from],
+		.captured = position.board[move->to],
+		.flags = move->flags,
+	};
+
+	if (move->flags & CHESS_MOVE_EN_PASSANT) {
+		record.captured = make_piece(CHESS_PIECE_PAWN, position.side ^ 1);
+	}
+	if (move->flags & CHESS_MOVE_PROMOTION) {
+		record.promotion = make_piece(move->promotion, position.side);
+	}
+
+	K_SPINLOCK(&game_lock) {
+		position = match->result;
+	}
+	save_snapshot();
+
+	publish_move(&record);
+}
+
+static void start_game(void)
+{
+	K_SPINLOCK(&game_lock) {
+		set_start_position(&position);
+		synced = true;
+	}
+	save_snapshot();
+	observation = OBSERVATION_DONE;
+	chessboard_boot_mark(CHESSBOARD_BOOT_GAME_STARTED);
+	LOG_INF("Start position detected, new game");
+}
+
+/* Resume the game of the snapshot if the board shows its occupancy, keep waiting otherwise */
+static bool resume_game(const struct chessboard_bitboards *bb)
+{
+	if (snapshot.magic != SNAPSHOT_MAGIC || snapshot.crc != snapshot_crc()) {
+		/* Cold boot, or the game was over before the reset */
+		atomic_clear(&resume_pending);
+		return false;
+	}
+
+	if (bb->positive != snapshot.position.occupancy[WHITE] ||
+	    bb->negative != snapshot.position.occupancy[BLACK]) {
+		return false;
+	}
+
+	K_SPINLOCK(&game_lock) {
+		position = snapshot.position;
+		synced = true;
+	}
+	atomic_clear(&resume_pending);
+	observation = OBSERVATION_DONE;
+	chessboard_boot_mark(CHESSBOARD_BOOT_GAME_RESUMED);
+	LOG_INF("Game resumed after reset at ply %u", position.ply);
+	return true;
+}
+
+static void evaluate_observation(uint32_t timestamp_ms)
+{
+	struct move_match match = {
+		.observed = {observed[WHITE], observed[BLACK]},
+		.current = {position.occupancy[WHITE], position.occupancy[BLACK]},
+	};
+
+	if (observed[WHITE] == position.occupancy[WHITE] &&
+	    observed[BLACK] == position.occupancy[BLACK]) {
+		/* Pieces were lifted and put back */
+		observation = OBSERVATION_DONE;
+		return;
+	}
+
+	if (observed[WHITE] == START_OCCUPANCY_WHITE && observed[BLACK] == START_OCCUPANCY_BLACK) {
+		/* The pieces were set up for a new game */
+		start_game();
+		return;
+	}
+
+	generate_moves(&position, match_move, &match);
+
+	if (match.matches == 1) {
+		accept_move(&match, timestamp_ms);
+		observation = OBSERVATION_DONE;
+	} else if (match.matches > 1) {
+		publish_rejection(CHESS_MOVE_AMBIGUOUS, timestamp_ms);
+		observation = OBSERVATION_DONE;
+	} else if (((observed[WHITE] & ~position.occupancy[WHITE]) == 0) &&
+		   ((observed[BLACK] & ~position.occupancy[BLACK]) == 0)) {
+		/* Only lifted pieces, the player may hold them as long as they want */
+		observation = OBSERVATION_DONE;
+	} else if (match.incomplete) {
+		observation = OBSERVATION_INCOMPLETE;
+	} else {
+		publish_rejection(CHESS_MOVE_ILLEGAL, timestamp_ms);
+		observation = OBSERVATION_DONE;
+	}
+}
+
+void chessboard_game_process(const struct chessboard_bitboards *bb, uint32_t timestamp_ms)
+{
+	if (atomic_cas(&new_game_pending, 1, 0)) {
+		K_SPINLOCK(&game_lock) {
+			synced = false;
+		}
+		snapshot.magic = 0;
+	}
+
+	if (!synced) {
+		if (bb->positive == START_OCCUPANCY_WHITE && bb->negative == START_OCCUPANCY_BLACK) {
+			start_game();
+		} else if (!atomic_get(&resume_pending) || !resume_game(bb)) {
+			return;
+		}
+		observed[WHITE] = bb->positive;
+		observed[BLACK] = bb->negative;
+		return;
+	}
+
+	if (bb->positive != observed[WHITE] || bb->negative != observed[BLACK]) {
+		observed[WHITE] = bb->positive;
+		observed[BLACK] = bb->negative;
+		observed_since_ms = timestamp_ms;
+		observation = OBSERVATION_NEW;
+		return;
+	}
+
+	const uint32_t stable_ms = timestamp_ms - observed_since_ms;
+
+	switch (observation) {
+	case OBSERVATION_NEW:
+		if (stable_ms >= GAME_SETTLE_MS) {
+			evaluate_observation(timestamp_ms);
+		}
+		break;
+	case OBSERVATION_INCOMPLETE:
+		if (stable_ms >= GAME_INCOMPLETE_MS) {
+			publish_rejection(CHESS_MOVE_ILLEGAL, timestamp_ms);
+			observation = OBSERVATION_DONE;
+		}
+		break;
+	default:
+		break;
+	}
+}
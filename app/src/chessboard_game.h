@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chessboard_detect.h"
+
+/*
+ * Game tracking. Piece colour comes from the magnet polarity: positive polarity squares hold
+ * white pieces and negative polarity squares black pieces.
+ */
+
+#define CHESS_PIECE_NONE      ((uint8_t)0u)
+#define CHESS_PIECE_PAWN      ((uint8_t)1u)
+#define CHESS_PIECE_KNIGHT    ((uint8_t)2u)
+#define CHESS_PIECE_BISHOP    ((uint8_t)3u)
+#define CHESS_PIECE_ROOK      ((uint8_t)4u)
+#define CHESS_PIECE_QUEEN     ((uint8_t)5u)
+#define CHESS_PIECE_KING      ((uint8_t)6u)
+#define CHESS_PIECE_TYPE_MASK ((uint8_t)0x07u)
+#define CHESS_PIECE_BLACK     ((uint8_t)0x08u)
+
+#define CHESS_MOVE_CAPTURE    ((uint8_t)0x01u)
+#define CHESS_MOVE_EN_PASSANT ((uint8_t)0x02u)
+#define CHESS_MOVE_CASTLE     ((uint8_t)0x04u)
+#define CHESS_MOVE_PROMOTION  ((uint8_t)0x08u)
+#define CHESS_MOVE_CHECK      ((uint8_t)0x10u)
+/* The board settled in a position no legal move leads to */
+#define CHESS_MOVE_ILLEGAL    ((uint8_t)0x40u)
+/* The board settled in a position more than one legal move leads to */
+#define CHESS_MOVE_AMBIGUOUS  ((uint8_t)0x80u)
+
+#define CHESS_MOVE_NO_SQUARE ((uint8_t)0xFFu)
+
+/* Maximum number of move queues that can be subscribed at the same time: the flight recorder and
+ * one per monitor session
+ */
+#define CHESSBOARD_GAME_MAX_SUBSCRIBERS 5
+
+/* One move, or an illegal/ambiguous board state */
+struct chessboard_move {
+	/* Timestamp of the frame the move was accepted in */
+	uint32_t timestamp_ms;
+	/* Number of half moves played before this one */
+	uint16_t ply;
+	/* CHESS_SQUARE() indices, CHESS_MOVE_NO_SQUARE for illegal and ambiguous records */
+	uint8_t from;
+	uint8_t to;
+	/* CHESS_PIECE_* including CHESS_PIECE_BLACK */
+	uint8_t piece;
+	uint8_t captured;
+	uint8_t promotion;
+	/* CHESS_MOVE_* */
+	uint8_t flags;
+};
+
+/* Forget the current game and wait for the pieces to be set up in the start position */
+void chessboard_game_new(void);
+
+/**
+ * Copy the current position.
+ *
+ * @return 0 on success, -EAGAIN while waiting for the start position.
+ */
+int chessboard_game_get_position(uint8_t board[CHESS_NUM_SQUARES], bool *black_to_move,
+				 uint16_t *ply);
+
+/**
+ * Subscribe a message queue of struct chessboard_move.
+ *
+ * @return 0 on success, -ENOMEM if all subscriber slots are taken.
+ */
+int chessboard_game_subscribe(struct k_msgq *queue);
+void chessboard_game_unsubscribe(struct k_msgq *queue);
+
+/* Track the game from the occupancy of a new frame, called by the scanner for every frame */
+void chessboard_game_process(const struct chessboard_bitboards *bb, uint32_t timestamp_ms);
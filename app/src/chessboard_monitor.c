@@ -0,0 +1,320 @@
+#include "chessboard_monitor.h"
+#include "chessboard_detect.h"
+#include "chessboard_game.h"
+#include "chessboard_render.h"
+#include "chessboard_scanner.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(chessboard_monitor, LOG_LEVEL_INF);
+
+#define MONITOR_WQ_STACK_SIZE   2048
+/* Same as the shell thread, printing never holds up the acquisition */
+#define MONITOR_WQ_PRIORITY     14
+/* The whole burst of a detection reset, so a session never misses part of the board */
+#define MONITOR_EVENT_QUEUE_LEN CHESSBOARD_DETECT_MAX_BURST
+#define MONITOR_MOVE_QUEUE_LEN  8
+#define MONITOR_QUEUE_SIZE                                                                         \
+	MAX(MONITOR_EVENT_QUEUE_LEN * sizeof(struct chessboard_event),                             \
+	    MONITOR_MOVE_QUEUE_LEN * sizeof(struct chessboard_move))
+#define MONITOR_STOP_TIMEOUT_MS 1000
+/* A backend that accepts nothing for this long is considered gone */
+#define MONITOR_WRITE_TIMEOUT_MS 1000
+
+/* Poll events of a session: its frames or its queue, and the request to quit */
+#define MONITOR_EVENT_SOURCE 0
+#define MONITOR_EVENT_QUIT   1
+
+struct monitor_session {
+	/* Taken by chessboard_monitor_start(), released by the session once it quit */
+	atomic_t in_use;
+	uint8_t type;
+	const struct shell *sh;
+	struct k_work_poll work;
+	struct k_poll_event events[2];
+	/* Raised by the scanner for every frame, only used by frame sessions */
+	struct k_poll_signal frame_signal;
+	struct k_poll_signal quit_signal;
+	struct k_sem stopped;
+	/* Events or moves, only used by event sessions */
+	struct k_msgq queue;
+	char queue_buffer[MONITOR_QUEUE_SIZE] __aligned(4);
+	uint32_t last_seq;
+	uint32_t printed;
+	uint32_t skipped;
+};
+
+static K_THREAD_STACK_DEFINE(monitor_wq_stack, MONITOR_WQ_STACK_SIZE);
+static struct k_work_q monitor_wq;
+/* Sessions are only started and stopped by the shell thread */
+static bool monitor_wq_started;
+static struct monitor_session sessions[CHESSBOARD_MONITOR_MAX_SESSIONS];
+
+/* Only used by the monitor work queue */
+static struct chessboard_frame frame;
+static char render_buf[CHESSBOARD_RENDER_BOARD_SIZE];
+
+int chessboard_monitor_write(const struct shell *sh, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	int64_t deadline = k_uptime_get() + MONITOR_WRITE_TIMEOUT_MS;
+
+	while (len > 0) {
+		size_t cnt;
+		int ret = sh->iface->api->write(sh->iface, p, len, &cnt);
+
+		if (ret != 0) {
+			return ret;
+		}
+
+		if (cnt == 0) {
+			if (k_uptime_get() >= deadline) {
+				return -ETIMEDOUT;
+			}
+			/* Transmit buffer full, let the backend drain it */
+			k_msleep(1);
+			continue;
+		}
+
+		p += cnt;
+		len -= cnt;
+		deadline = k_uptime_get() + MONITOR_WRITE_TIMEOUT_MS;
+	}
+	return 0;
+}
+
+static bool is_frame_session(const struct monitor_session *session)
+{
+	return (session->type == CHESSBOARD_MONITOR_VOLTAGE) ||
+	       (session->type == CHESSBOARD_MONITOR_OFFSET);
+}
+
+static int subscribe(struct monitor_session *session)
+{
+	switch (session->type) {
+	case CHESSBOARD_MONITOR_THRESHOLD:
+		return chessboard_detect_subscribe(&session->queue);
+	case CHESSBOARD_MONITOR_MOVES:
+		return chessboard_game_subscribe(&session->queue);
+	default:
+		return chessboard_scanner_subscribe(&session->frame_signal);
+	}
+}
+
+static void unsubscribe(struct monitor_session *session)
+{
+	switch (session->type) {
+	case CHESSBOARD_MONITOR_THRESHOLD:
+		chessboard_detect_unsubscribe(&session->queue);
+		break;
+	case CHESSBOARD_MONITOR_MOVES:
+		chessboard_game_unsubscribe(&session->queue);
+		break;
+	default:
+		chessboard_scanner_unsubscribe(&session->frame_signal);
+		break;
+	}
+}
+
+static int submit(struct monitor_session *session)
+{
+	session->events[MONITOR_EVENT_SOURCE].state = K_POLL_STATE_NOT_READY;
+	session->events[MONITOR_EVENT_QUIT].state = K_POLL_STATE_NOT_READY;
+	return k_work_poll_submit_to_queue(&monitor_wq, &session->work, session->events,
+					   ARRAY_SIZE(session->events), K_FOREVER);
+}
+
+/* Print the text in render_buf through the shell, which serialises it with the output of the shell
+ * thread and redraws the prompt after it
+ */
+static void print_text(struct monitor_session *session)
+{
+	shell_fprintf(session->sh, SHELL_NORMAL, "%s", render_buf);
+	session->printed++;
+}
+
+static void print_frame(struct monitor_session *session)
+{
+	/* Reset first, a frame published from here on runs the session again */
+	k_poll_signal_reset(&session->frame_signal);
+
+	if ((chessboard_get_frame(&frame) != 0) || (frame.seq == session->last_seq)) {
+		return;
+	}
+	if (session->last_seq != 0) {
+		session->skipped += frame.seq - session->last_seq - 1;
+	}
+	session->last_seq = frame.seq;
+
+	const int len = chessboard_render_files(render_buf, sizeof(render_buf), &frame,
+						(session->type == CHESSBOARD_MONITOR_VOLTAGE)
+							? chessboard_frame_get_mv
+							: chessboard_frame_get_mv_offset);
+
+	if (len > 0) {
+		print_text(session);
+	}
+}
+
+static void print_events(struct monitor_session *session)
+{
+	union {
+		struct chessboard_event event;
+		struct chessboard_move move;
+	} msg;
+
+	while (k_msgq_get(&session->queue, &msg, K_NO_WAIT) == 0) {
+		const int len = (session->type == CHESSBOARD_MONITOR_THRESHOLD)
+					? chessboard_render_event(render_buf, sizeof(render_buf),
+								  &msg.event)
+					: chessboard_render_move(render_buf, sizeof(render_buf),
+								 &msg.move);
+
+		if (len > 0) {
+			print_text(session);
+		}
+	}
+}
+
+static void end_session(struct monitor_session *session)
+{
+	unsubscribe(session);
+	atomic_clear(&session->in_use);
+	k_sem_give(&session->stopped);
+}
+
+/* Runs on the monitor work queue whenever a frame or an event arrived, or the session was told to
+ * quit. Only the handler resubmits the work, so the quit signal is always seen.
+ */
+static void monitor_work_handler(struct k_work *work)
+{
+	struct k_work_poll *poll = CONTAINER_OF(work, struct k_work_poll, work);
+	struct monitor_session *session = CONTAINER_OF(poll, struct monitor_session, work);
+	unsigned int quit;
+	int result;
+
+	k_poll_signal_check(&session->quit_signal, &quit, &result);
+	if (quit) {
+		end_session(session);
+		return;
+	}
+
+	if (is_frame_session(session)) {
+		print_frame(session);
+	} else {
+		print_events(session);
+	}
+
+	int ret = submit(session);
+	if (ret != 0) {
+		LOG_ERR("Monitor session %d ended, could not wait for more (%d)",
+			(int)(session - sessions), ret);
+		end_session(session);
+	}
+}
+
+int chessboard_monitor_start(const struct shell *sh, uint8_t type)
+{
+	struct monitor_session *session = NULL;
+	int id;
+
+	if (type >= CHESSBOARD_MONITOR_NUM_TYPES) {
+		return -EINVAL;
+	}
+
+	if (!monitor_wq_started) {
+		const struct k_work_queue_config wq_config = {.name = "monitor_wq"};
+
+		k_work_queue_start(&monitor_wq, monitor_wq_stack,
+				   K_THREAD_STACK_SIZEOF(monitor_wq_stack), MONITOR_WQ_PRIORITY,
+				   &wq_config);
+		monitor_wq_started = true;
+	}
+
+	for (id = 0; id < ARRAY_SIZE(sessions); id++) {
+		if (!atomic_cas(&sessions[id].in_use, 0, 1)) {
+			continue;
+		}
+		if (k_work_busy_get(&sessions[id].work.work) != 0) {
+			/* Just quit, its handler is still returning */
+			atomic_clear(&sessions[id].in_use);
+			continue;
+		}
+		session = &sessions[id];
+		break;
+	}
+	if (session == NULL) {
+		return -ENOMEM;
+	}
+
+	session->type = type;
+	session->sh = sh;
+	session->last_seq = 0;
+	session->printed = 0;
+	session->skipped = 0;
+	k_poll_signal_init(&session->frame_signal);
+	k_poll_signal_init(&session->quit_signal);
+	k_sem_init(&session->stopped, 0, 1);
+	k_work_poll_init(&session->work, monitor_work_handler);
+
+	if (is_frame_session(session)) {
+		k_poll_event_init(&session->events[MONITOR_EVENT_SOURCE], K_POLL_TYPE_SIGNAL,
+				  K_POLL_MODE_NOTIFY_ONLY, &session->frame_signal);
+	} else {
+		const size_t msg_size = (type == CHESSBOARD_MONITOR_THRESHOLD)
+						? sizeof(struct chessboard_event)
+						: sizeof(struct chessboard_move);
+
+		k_msgq_init(&session->queue, session->queue_buffer, msg_size,
+			    sizeof(session->queue_buffer) / msg_size);
+		k_poll_event_init(&session->events[MONITOR_EVENT_SOURCE],
+				  K_POLL_TYPE_MSGQ_DATA_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY,
+				  &session->queue);
+	}
+	k_poll_event_init(&session->events[MONITOR_EVENT_QUIT], K_POLL_TYPE_SIGNAL,
+			  K_POLL_MODE_NOTIFY_ONLY, &session->quit_signal);
+
+	int ret = subscribe(session);
+	if (ret != 0) {
+		atomic_clear(&session->in_use);
+		return ret;
+	}
+
+	ret = submit(session);
+	if (ret != 0) {
+		unsubscribe(session);
+		atomic_clear(&session->in_use);
+		return ret;
+	}
+	return id;
+}
+
+int chessboard_monitor_stop(int id)
+{
+	if ((id < 0) || (id >= ARRAY_SIZE(sessions)) || !atomic_get(&sessions[id].in_use)) {
+		return -ENOENT;
+	}
+
+	/* Delivered like any other event, the session ends the next time it runs */
+	k_poll_signal_raise(&sessions[id].quit_signal, 0);
+
+	if (k_sem_take(&sessions[id].stopped, K_MSEC(MONITOR_STOP_TIMEOUT_MS)) != 0) {
+		return -EAGAIN;
+	}
+	return 0;
+}
+
+int chessboard_monitor_get_info(int id, struct chessboard_monitor_info *info)
+{
+	if ((id < 0) || (id >= ARRAY_SIZE(sessions)) || !atomic_get(&sessions[id].in_use)) {
+		return -ENOENT;
+	}
+
+	info->type = sessions[id].type;
+	info->printed = sessions[id].printed;
+	info->skipped = sessions[id].skipped;
+	return 0;
+}
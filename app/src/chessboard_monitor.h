@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/shell/shell.h>
+
+/* Voltage of every square, one line per file, for every published frame */
+#define CHESSBOARD_MONITOR_VOLTAGE   ((uint8_t)0u)
+/* Offset from calibration of every square, one line per file, for every published frame */
+#define CHESSBOARD_MONITOR_OFFSET    ((uint8_t)1u)
+/* State changes of the squares reported by the detection engine */
+#define CHESSBOARD_MONITOR_THRESHOLD ((uint8_t)2u)
+/* Moves accepted and positions rejected by game tracking */
+#define CHESSBOARD_MONITOR_MOVES     ((uint8_t)3u)
+#define CHESSBOARD_MONITOR_NUM_TYPES 4
+
+/* Number of sessions that can run at the same time */
+#define CHESSBOARD_MONITOR_MAX_SESSIONS 4
+
+struct chessboard_monitor_info {
+	/* CHESSBOARD_MONITOR_* */
+	uint8_t type;
+	/* Frames or events printed so far */
+	uint32_t printed;
+	/* Frames published while the previous one was still being printed, only the latest frame is
+	 * printed. Always 0 for event sessions, events are queued instead.
+	 */
+	uint32_t skipped;
+};
+
+/**
+ * Start a monitor session that prints to @p sh in the background, on the monitor work queue. The
+ * session only runs when a frame or an event arrives, the shell stays usable in the meantime.
+ *
+ * @return Session id, -ENOMEM if all sessions are in use, or a negative error if the session
+ *	   could not subscribe to its source.
+ */
+int chessboard_monitor_start(const struct shell *sh, uint8_t type);
+
+/**
+ * Stop a session. The session is told to quit and this waits until it printed its last line.
+ *
+ * @return 0 on success, -ENOENT if no session with that id runs, -EAGAIN if the session did not
+ *	   finish in time. It still stops, as soon as its output is written.
+ */
+int chessboard_monitor_stop(int id);
+
+/**
+ * @return 0 and the state of the session in @p info, or -ENOENT if no session with that id runs.
+ */
+int chessboard_monitor_get_info(int id, struct chessboard_monitor_info *info);
+
+/**
+ * Write @p data to the backend of @p sh as it is, without printf formatting and its buffer
+ * limits, waiting for the backend whenever its transmit buffer is full. Bypasses the shell, so
+ * only for the shell thread; the sessions print with shell_fprintf().
+ *
+ * @return 0 once everything is written, -ETIMEDOUT if the backend accepted nothing for a second,
+ *         or the error of the backend.
+ */
+int chessboard_monitor_write(const struct shell *sh, const void *data, size_t len);
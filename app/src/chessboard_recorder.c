@@ -0,0 +1,418 @@
+#include "chessboard_recorder.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(chessboard_recorder, LOG_LEVEL_INF);
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CHESSBOARD_RECORDER_SIZE), "Recorder size must be a power of two");
+
+#define RING_MASK (CHESSBOARD_RECORDER_SIZE - 1)
+
+/* A keyframe is written once this many bytes were written since the last one, so at most this
+ * much at the start of the ring cannot be decoded after older records were dropped
+ */
+#define KEYFRAME_DISTANCE (CHESSBOARD_RECORDER_SIZE / 4)
+
+/* Longest record body: tag, two 5 byte varints, a 10 byte mask and 64 values of up to 3 bytes */
+#define RECORD_MAX_SIZE (1 + 5 + 5 + 10 + (CHESS_NUM_SQUARES * 3))
+BUILD_ASSERT(RECORD_MAX_SIZE <= UINT8_MAX, "Record length must fit its length byte");
+
+/* Moves published by game tracking, drained by the scanner thread with every frame */
+K_MSGQ_DEFINE(recorder_move_queue, sizeof(struct chessboard_move), 8, 4);
+
+static struct k_spinlock recorder_lock;
+static uint8_t ring[CHESSBOARD_RECORDER_SIZE];
+/* Free running byte positions, the ring index is the position & RING_MASK */
+static uint32_t head;
+static uint32_t tail;
+static uint32_t read_start;
+static bool reading;
+static struct chessboard_recorder_status status = {
+	.trigger = CHESS_MOVE_ILLEGAL | CHESS_MOVE_AMBIGUOUS,
+};
+
+/* Only used by the scanner thread */
+static bool subscribed;
+static int16_t recorded[CHESS_NUM_SQUARES];
+static uint32_t last_ms;
+static uint32_t last_seq;
+static uint32_t keyframe_distance = KEYFRAME_DISTANCE;
+static uint8_t body[RECORD_MAX_SIZE];
+
+static uint8_t *put_varint(uint8_t *p, uint64_t value)
+{
+	while (value >= 0x80) {
+		*p++ = (uint8_t)value | 0x80;
+		value >>= 7;
+	}
+	*p++ = (uint8_t)value;
+	return p;
+}
+
+static uint8_t *put_zigzag(uint8_t *p, int32_t value)
+{
+	return put_varint(p, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static int get_varint(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (*p >= end) {
+			return -EBADMSG;
+		}
+
+		const uint8_t byte = *(*p)++;
+
+		*value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			return 0;
+		}
+	}
+	return -EBADMSG;
+}
+
+static int get_zigzag(const uint8_t **p, const uint8_t *end, int32_t *value)
+{
+	uint64_t raw;
+	int ret = get_varint(p, end, &raw);
+
+	*value = (int32_t)((uint32_t)raw >> 1) ^ -(int32_t)(raw & 1);
+	return ret;
+}
+
+/* Called with the lock held and not while the recording is read */
+static void append(const uint8_t *record, size_t len)
+{
+	while ((CHESSBOARD_RECORDER_SIZE - (head - tail)) < (len + 1)) {
+		tail += 1 + ring[tail & RING_MASK];
+		status.records--;
+		status.overwritten++;
+	}
+
+	ring[head++ & RING_MASK] = (uint8_t)len;
+	for (size_t i = 0; i < len; i++) {
+		ring[head++ & RING_MASK] = record[i];
+	}
+	status.records++;
+	status.used = head - tail;
+}
+
+/* Store the record in body, returns false if the recorder is frozen or being read */
+static bool store(size_t len, uint32_t timestamp_ms)
+{
+	bool stored = false;
+
+	K_SPINLOCK(&recorder_lock) {
+		if (!status.frozen && !reading) {
+			append(body, len);
+			status.newest_ms = timestamp_ms;
+			stored = true;
+		}
+	}
+	return stored;
+}
+
+static void record_move(const struct chessboard_move *move)
+{
+	uint8_t *p = body;
+
+	*p++ = CHESSBOARD_RECORDER_MOVE;
+	p = put_varint(p, move->timestamp_ms - last_ms);
+	p = put_varint(p, move->ply);
+	*p++ = move->from;
+	*p++ = move->to;
+	*p++ = move->piece;
+	*p++ = move->captured;
+	*p++ = move->promotion;
+	*p++ = move->flags;
+
+	if (!store(p - body, move->timestamp_ms)) {
+		return;
+	}
+	last_ms = move->timestamp_ms;
+
+	K_SPINLOCK(&recorder_lock) {
+		status.moves++;
+		if ((move->flags & status.trigger) && (status.triggered_by == 0)) {
+			status.triggered_by = move->flags & status.trigger;
+			status.triggered_ms = move->timestamp_ms;
+		}
+	}
+}
+
+/* Encode a keyframe or a delta into body, without updating the recorded values yet. Returns the
+ * length, 0 if no square moved beyond the dead-band.
+ */
+static size_t encode_frame(const struct chessboard_frame *frame, bool keyframe, uint64_t *mask)
+{
+	uint8_t *p = body;
+
+	*mask = keyframe ? UINT64_MAX : 0;
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		if (((frame->scanned >> square) & 1) &&
+		    (ABS(frame->raw[square] - recorded[square]) > CHESSBOARD_RECORDER_DEADBAND)) {
+			*mask |= BIT64(square);
+		}
+	}
+
+	if (keyframe) {
+		*p++ = CHESSBOARD_RECORDER_KEYFRAME;
+		p = put_varint(p, frame->timestamp_ms);
+		p = put_varint(p, frame->seq);
+		for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+			p = put_zigzag(p, frame->raw[square]);
+		}
+		return p - body;
+	}
+
+	if (*mask == 0) {
+		return 0;
+	}
+
+	*p++ = CHESSBOARD_RECORDER_DELTA;
+	p = put_varint(p, frame->timestamp_ms - last_ms);
+	p = put_varint(p, frame->seq - last_seq);
+	p = put_varint(p, *mask);
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		if (*mask & BIT64(square)) {
+			p = put_zigzag(p, frame->raw[square] - recorded[square]);
+		}
+	}
+	return p - body;
+}
+
+void chessboard_recorder_record(const struct chessboard_frame *frame)
+{
+	const bool keyframe = (keyframe_distance >= KEYFRAME_DISTANCE);
+	struct chessboard_move move;
+	uint64_t mask;
+
+	if (!subscribed) {
+		subscribed = (chessboard_game_subscribe(&recorder_move_queue) == 0);
+	}
+	while (k_msgq_get(&recorder_move_queue, &move, K_NO_WAIT) == 0) {
+		record_move(&move);
+	}
+
+	const size_t len = encode_frame(frame, keyframe, &mask);
+
+	if (len == 0) {
+		K_SPINLOCK(&recorder_lock) {
+			status.unchanged++;
+		}
+	} else if (store(len, frame->timestamp_ms)) {
+		/* The next delta is relative to what was stored */
+		for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+			if (mask & BIT64(square)) {
+				recorded[square] = frame->raw[square];
+			}
+		}
+		keyframe_distance = keyframe ? 0 : (keyframe_distance + len + 1);
+		last_ms = frame->timestamp_ms;
+		last_seq = frame->seq;
+
+		K_SPINLOCK(&recorder_lock) {
+			status.frames++;
+			status.keyframes += keyframe ? 1 : 0;
+		}
+	} else {
+		K_SPINLOCK(&recorder_lock) {
+			status.skipped++;
+		}
+	}
+
+	bool frozen = false;
+
+	K_SPINLOCK(&recorder_lock) {
+		if (!status.frozen && (status.triggered_by != 0) &&
+		    ((frame->timestamp_ms - status.triggered_ms) >=
+		     CHESSBOARD_RECORDER_POST_TRIGGER_MS)) {
+			status.frozen = true;
+			frozen = true;
+		}
+	}
+	if (frozen) {
+		LOG_INF("Frozen after a rejected position, resume with 'board recorder resume'");
+	}
+}
+
+void chessboard_recorder_freeze(void)
+{
+	K_SPINLOCK(&recorder_lock) {
+		status.frozen = true;
+	}
+}
+
+void chessboard_recorder_resume(void)
+{
+	K_SPINLOCK(&recorder_lock) {
+		status.frozen = false;
+		status.triggered_by = 0;
+	}
+}
+
+void chessboard_recorder_set_trigger(uint8_t flags)
+{
+	K_SPINLOCK(&recorder_lock) {
+		status.trigger = flags & (CHESS_MOVE_ILLEGAL | CHESS_MOVE_AMBIGUOUS);
+	}
+}
+
+void chessboard_recorder_get_status(struct chessboard_recorder_status *copy)
+{
+	K_SPINLOCK(&recorder_lock) {
+		*copy = status;
+	}
+}
+
+int chessboard_recorder_begin_read(void)
+{
+	int ret = -EBUSY;
+
+	K_SPINLOCK(&recorder_lock) {
+		if (!reading) {
+			reading = true;
+
+			/* Deltas before the oldest keyframe cannot be decoded */
+			read_start = tail;
+			while ((read_start != head) && (ring[(read_start + 1) & RING_MASK] !=
+							CHESSBOARD_RECORDER_KEYFRAME)) {
+				read_start += 1 + ring[read_start & RING_MASK];
+			}
+			ret = (int)(head - read_start);
+		}
+	}
+	return ret;
+}
+
+size_t chessboard_recorder_read(size_t offset, uint8_t *buf, size_t len)
+{
+	/* Head and tail do not move while reading */
+	const size_t available = head - read_start;
+
+	if (offset >= available) {
+		return 0;
+	}
+
+	len = MIN(len, available - offset);
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = ring[(read_start + offset + i) & RING_MASK];
+	}
+	return len;
+}
+
+void chessboard_recorder_end_read(void)
+{
+	K_SPINLOCK(&recorder_lock) {
+		reading = false;
+	}
+}
+
+void chessboard_recorder_reader_init(struct chessboard_recorder_reader *reader, size_t len)
+{
+	memset(reader, 0, sizeof(*reader));
+	reader->len = len;
+}
+
+static int decode_move(struct chessboard_recorder_entry *entry, const uint8_t *p,
+		       const uint8_t *end)
+{
+	uint64_t dt_ms;
+	uint64_t ply;
+
+	if ((get_varint(&p, end, &dt_ms) != 0) || (get_varint(&p, end, &ply) != 0) ||
+	    ((end - p) != 6)) {
+		return -EBADMSG;
+	}
+
+	entry->timestamp_ms += (uint32_t)dt_ms;
+	entry->changed = 0;
+	entry->move = (struct chessboard_move){
+		.timestamp_ms = entry->timestamp_ms,
+		.ply = (uint16_t)ply,
+		.from = p[0],
+		.to = p[1],
+		.piece = p[2],
+		.captured = p[3],
+		.promotion = p[4],
+		.flags = p[5],
+	};
+	return 0;
+}
+
+static int decode_frame(struct chessboard_recorder_entry *entry, uint8_t tag, const uint8_t *p,
+			const uint8_t *end)
+{
+	uint64_t time;
+	uint64_t seq;
+	uint64_t mask = UINT64_MAX;
+	int32_t value;
+
+	if ((get_varint(&p, end, &time) != 0) || (get_varint(&p, end, &seq) != 0)) {
+		return -EBADMSG;
+	}
+	if ((tag == CHESSBOARD_RECORDER_DELTA) && (get_varint(&p, end, &mask) != 0)) {
+		return -EBADMSG;
+	}
+
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		if (!(mask & BIT64(square))) {
+			continue;
+		}
+		if (get_zigzag(&p, end, &value) != 0) {
+			return -EBADMSG;
+		}
+		entry->raw[square] = (int16_t)((tag == CHESSBOARD_RECORDER_DELTA)
+							       ? entry->raw[square] + value
+							       : value);
+	}
+	if (p != end) {
+		return -EBADMSG;
+	}
+
+	if (tag == CHESSBOARD_RECORDER_DELTA) {
+		entry->timestamp_ms += (uint32_t)time;
+		entry->seq += (uint32_t)seq;
+	} else {
+		entry->timestamp_ms = (uint32_t)time;
+		entry->seq = (uint32_t)seq;
+	}
+	entry->changed = mask;
+	return 0;
+}
+
+int chessboard_recorder_next(struct chessboard_recorder_reader *reader)
+{
+	uint8_t record[1 + UINT8_MAX];
+
+	if ((reader->offset >= reader->len) ||
+	    (chessboard_recorder_read(reader->offset, record, 1) != 1)) {
+		return -ENODATA;
+	}
+
+	const size_t len = record[0];
+
+	if ((len == 0) || (chessboard_recorder_read(reader->offset + 1, record, len) != len)) {
+		return -EBADMSG;
+	}
+	reader->offset += 1 + len;
+
+	const uint8_t tag = record[0];
+
+	reader->entry.tag = tag;
+	switch (tag) {
+	case CHESSBOARD_RECORDER_KEYFRAME:
+	case CHESSBOARD_RECORDER_DELTA:
+		return decode_frame(&reader->entry, tag, &record[1], &record[len]);
+	case CHESSBOARD_RECORDER_MOVE:
+		return decode_move(&reader->entry, &record[1], &record[len]);
+	default:
+		return -EBADMSG;
+	}
+}
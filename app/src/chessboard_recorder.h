@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chessboard.h"
+#include "chessboard_game.h"
+#include "chessboard_scanner.h"
+
+/*
+ * Flight recorder: the frames of the last seconds, the moves and the rejected positions, packed
+ * into a fixed size ring buffer in RAM. Recording is always on, the oldest records are dropped to
+ * make room for new ones.
+ *
+ * Every record is its length in bytes, then its body:
+ *
+ *   u8     tag     CHESSBOARD_RECORDER_KEYFRAME, _DELTA or _MOVE
+ *
+ *   keyframe:
+ *   varint timestamp_ms
+ *   varint seq
+ *   zigzag value[64]             CHESS_SQUARE() order, A1 first
+ *
+ *   delta, a frame where at least one square moved beyond the dead-band:
+ *   varint dt_ms                 since the previous record
+ *   varint dseq                  since the previous frame record
+ *   varint mask                  bit n set if square n is included
+ *   zigzag delta[]               change of every included square, in ascending square order
+ *
+ *   move, a move accepted or a position rejected by game tracking:
+ *   varint dt_ms                 since the previous record
+ *   varint ply
+ *   u8     from, to, piece, captured, promotion, flags   as in struct chessboard_move
+ *
+ * Varints are little endian base 128, zigzag values are varints of (v << 1) ^ (v >> 31). Values
+ * are the filtered raw counts of the frames. A delta applies to the values of the frame record
+ * before it, so a recording is decoded from its first keyframe on.
+ */
+#define CHESSBOARD_RECORDER_KEYFRAME ((uint8_t)1u)
+#define CHESSBOARD_RECORDER_DELTA    ((uint8_t)2u)
+#define CHESSBOARD_RECORDER_MOVE     ((uint8_t)3u)
+
+/* Version of the record layout above, part of binary dumps. Format 1 recorded millivolts. */
+#define CHESSBOARD_RECORDER_FORMAT 2
+
+/* Size of the ring buffer in bytes, a power of two */
+#define CHESSBOARD_RECORDER_SIZE        4096
+/* Squares that moved less than this many raw counts, about 3 mV, since they were last recorded
+ * are not recorded again
+ */
+#define CHESSBOARD_RECORDER_DEADBAND    4
+/* Frames still recorded after a trigger, before the recorder freezes */
+#define CHESSBOARD_RECORDER_POST_TRIGGER_MS 500
+
+struct chessboard_recorder_status {
+	/* Bytes in use, of CHESSBOARD_RECORDER_SIZE */
+	uint32_t used;
+	uint32_t records;
+	/* Timestamp of the latest record */
+	uint32_t newest_ms;
+	/* Frames recorded as keyframe or delta */
+	uint32_t frames;
+	uint32_t keyframes;
+	/* Frames without a square beyond the dead-band, nothing was stored for them */
+	uint32_t unchanged;
+	/* Frames not recorded because the recorder was frozen or being read */
+	uint32_t skipped;
+	uint32_t moves;
+	/* Records dropped to make room */
+	uint32_t overwritten;
+	/* CHESS_MOVE_* flags of rejections that freeze the recorder, 0 if none */
+	uint8_t trigger;
+	/* CHESS_MOVE_* flags of the rejection that triggered, 0 if not triggered */
+	uint8_t triggered_by;
+	uint32_t triggered_ms;
+	bool frozen;
+};
+
+/* Record a frame and the moves published since the last one, only called by the scanner thread */
+void chessboard_recorder_record(const struct chessboard_frame *frame);
+
+/* Stop recording, e.g. right after the board missed a move, so the evidence is kept */
+void chessboard_recorder_freeze(void);
+/* Continue recording after a freeze or a trigger, and arm the trigger again */
+void chessboard_recorder_resume(void);
+
+/**
+ * Freeze the recorder CHESSBOARD_RECORDER_POST_TRIGGER_MS after game tracking rejected a
+ * position with any of @p flags, CHESS_MOVE_ILLEGAL and CHESS_MOVE_AMBIGUOUS. 0 never freezes.
+ */
+void chessboard_recorder_set_trigger(uint8_t flags);
+
+void chessboard_recorder_get_status(struct chessboard_recorder_status *status);
+
+/**
+ * Pause recording and make the recording readable, from its oldest keyframe on. Frames published
+ * until chessboard_recorder_end_read() are skipped.
+ *
+ * @return Length of the recording in bytes, or -EBUSY if it is already being read.
+ */
+int chessboard_recorder_begin_read(void);
+
+/* Copy up to @p len bytes of the recording from @p offset, returns the number of bytes copied */
+size_t chessboard_recorder_read(size_t offset, uint8_t *buf, size_t len);
+
+void chessboard_recorder_end_read(void);
+
+/* A decoded record, together with the values of the squares after applying it */
+struct chessboard_recorder_entry {
+	/* CHESSBOARD_RECORDER_* */
+	uint8_t tag;
+	uint32_t timestamp_ms;
+	/* Sequence number of the latest frame record */
+	uint32_t seq;
+	/* Squares included in the record, all of them for a keyframe, none for a move */
+	uint64_t changed;
+	int16_t raw[CHESS_NUM_SQUARES];
+	/* Only for moves */
+	struct chessboard_move move;
+};
+
+struct chessboard_recorder_reader {
+	size_t offset;
+	size_t len;
+	struct chessboard_recorder_entry entry;
+};
+
+/* Start decoding a recording of @p len bytes, as returned by chessboard_recorder_begin_read() */
+void chessboard_recorder_reader_init(struct chessboard_recorder_reader *reader, size_t len);
+
+/**
+ * Decode the next record into reader->entry.
+ *
+ * @return 0 on success, -ENODATA at the end of the recording, -EBADMSG if a record is malformed.
+ */
+int chessboard_recorder_next(struct chessboard_recorder_reader *reader);
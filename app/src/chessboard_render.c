@@ -0,0 +1,169 @@
+#include "chessboard_render.h"
+
+#include <errno.h>
+
+#include <zephyr/sys/util.h>
+
+static const uint32_t powers_of_ten[] = {
+	1000000000u, 100000000u, 10000000u, 1000000u, 100000u, 10000u, 1000u, 100u, 10u,
+};
+
+/* Right aligned in at least @p width columns. The Cortex-M0+ has no divide instruction, so the
+ * digits are found by subtracting powers of ten instead of a library division per digit. Values
+ * on the board are a few digits at most.
+ */
+static char *put_value(char *p, int32_t value, int width)
+{
+	uint32_t magnitude = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+	char digits[CHESSBOARD_RENDER_VALUE_MAX];
+	int len = 0;
+
+	if (value < 0) {
+		digits[len++] = '-';
+	}
+	const int first_digit = len;
+
+	for (int i = 0; i < ARRAY_SIZE(powers_of_ten); i++) {
+		char digit = '0';
+
+		while (magnitude >= powers_of_ten[i]) {
+			magnitude -= powers_of_ten[i];
+			digit++;
+		}
+		if (digit != '0' || len > first_digit) {
+			digits[len++] = digit;
+		}
+	}
+	digits[len++] = '0' + (char)magnitude;
+
+	for (int pad = width - len; pad > 0; pad--) {
+		*p++ = ' ';
+	}
+	for (int i = 0; i < len; i++) {
+		*p++ = digits[i];
+	}
+	return p;
+}
+
+int chessboard_render_board(char *buf, size_t size, const struct chessboard_frame *frame,
+			    chessboard_render_value_t get_value)
+{
+	char *p = buf;
+
+	if (size < CHESSBOARD_RENDER_BOARD_SIZE) {
+		return -ENOSPC;
+	}
+
+	for (int rank = CHESS_NUM_RANKS - 1; rank >= 0; rank--) {
+		*p++ = '1' + rank;
+		for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+			*p++ = '|';
+			p = put_value(p, get_value(frame, file, rank),
+				      CHESSBOARD_RENDER_VALUE_WIDTH);
+		}
+		*p++ = '\n';
+	}
+	*p++ = '\n';
+	*p = '\0';
+	return p - buf;
+}
+
+int chessboard_render_files(char *buf, size_t size, const struct chessboard_frame *frame,
+			    chessboard_render_value_t get_value)
+{
+	char *p = buf;
+
+	if (size < CHESSBOARD_RENDER_BOARD_SIZE) {
+		return -ENOSPC;
+	}
+
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		*p++ = 'A' + file;
+		for (uint8_t rank = 0; rank < CHESS_NUM_RANKS; rank++) {
+			*p++ = '|';
+			p = put_value(p, get_value(frame, file, rank),
+				      CHESSBOARD_RENDER_VALUE_WIDTH);
+		}
+		*p++ = '\n';
+	}
+	*p = '\0';
+	return p - buf;
+}
+
+char chessboard_render_piece(uint8_t piece)
+{
+	static const char piece_chars[] = ".pnbrqk";
+	const char c = piece_chars[piece & CHESS_PIECE_TYPE_MASK];
+
+	/* Upper case for white, as in FEN */
+	return (piece & CHESS_PIECE_BLACK) || piece == CHESS_PIECE_NONE ? c : c - 'a' + 'A';
+}
+
+static char *put_string(char *p, const char *s)
+{
+	while (*s != '\0') {
+		*p++ = *s++;
+	}
+	return p;
+}
+
+static char *put_square(char *p, uint8_t square, char first_file)
+{
+	*p++ = first_file + (square % CHESS_NUM_FILES);
+	*p++ = '1' + (square / CHESS_NUM_FILES);
+	return p;
+}
+
+int chessboard_render_event(char *buf, size_t size, const struct chessboard_event *event)
+{
+	static const char state_prefix[] = {
+		[CHESS_SQUARE_NEGATIVE] = '-',
+		[CHESS_SQUARE_POSITIVE] = '+',
+		[CHESS_SQUARE_NEUTRAL] = ' ',
+		[CHESS_SQUARE_UNKNOWN] = '?',
+	};
+	char *p = buf;
+
+	if (size < CHESSBOARD_RENDER_LINE_SIZE) {
+		return -ENOSPC;
+	}
+
+	*p++ = state_prefix[event->new_state];
+	p = put_square(p, event->square, 'A');
+	*p++ = '\n';
+	*p = '\0';
+	return p - buf;
+}
+
+int chessboard_render_move(char *buf, size_t size, const struct chessboard_move *move)
+{
+	char *p = buf;
+
+	if (size < CHESSBOARD_RENDER_LINE_SIZE) {
+		return -ENOSPC;
+	}
+
+	p = put_value(p, (move->ply / 2) + 1, 0);
+	p = put_string(p, (move->ply & 1) ? "..." : ".");
+
+	if (move->flags & CHESS_MOVE_ILLEGAL) {
+		p = put_string(p, " illegal position");
+	} else if (move->flags & CHESS_MOVE_AMBIGUOUS) {
+		p = put_string(p, " ambiguous position");
+	} else {
+		/* Coordinate notation, e.g. e2e4 or e7e8q */
+		*p++ = ' ';
+		p = put_square(p, move->from, 'a');
+		p = put_square(p, move->to, 'a');
+		if (move->flags & CHESS_MOVE_PROMOTION) {
+			/* Lower case, as in coordinate notation */
+			*p++ = chessboard_render_piece(move->promotion | CHESS_PIECE_BLACK);
+		}
+		if (move->flags & CHESS_MOVE_CHECK) {
+			*p++ = '+';
+		}
+	}
+	*p++ = '\n';
+	*p = '\0';
+	return p - buf;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chessboard.h"
+#include "chessboard_detect.h"
+#include "chessboard_game.h"
+#include "chessboard_scanner.h"
+
+/* Values are right aligned in this many columns, like "%4d", longer ones are printed in full */
+#define CHESSBOARD_RENDER_VALUE_WIDTH 4
+/* Longest value, "-2147483648" */
+#define CHESSBOARD_RENDER_VALUE_MAX   11
+/* A label, a '|' and a value per square, and the newline */
+#define CHESSBOARD_RENDER_LINE_SIZE                                                                \
+	(1 + (CHESS_NUM_FILES * (1 + CHESSBOARD_RENDER_VALUE_MAX)) + 1)
+/* Eight lines, the empty line after the board and the terminating nul */
+#define CHESSBOARD_RENDER_BOARD_SIZE ((CHESS_NUM_RANKS * CHESSBOARD_RENDER_LINE_SIZE) + 2)
+
+typedef int32_t (*chessboard_render_value_t)(const struct chessboard_frame *frame, uint8_t file,
+					      uint8_t rank);
+
+/**
+ * Render the value of every square into @p buf, one line per rank from rank 8 down to rank 1,
+ * followed by an empty line, e.g. "8|  12|  -3|...". Nothing is allocated and no printf
+ * formatting is involved, so the whole board can be written to the shell in one call.
+ *
+ * @param size Size of @p buf, at least CHESSBOARD_RENDER_BOARD_SIZE.
+ *
+ * @return Length of the nul terminated text, or -ENOSPC if @p buf is too small.
+ */
+int chessboard_render_board(char *buf, size_t size, const struct chessboard_frame *frame,
+			    chessboard_render_value_t get_value);
+
+/**
+ * Render the value of every square into @p buf, one line per file from file A to file H, ranks 1
+ * to 8 from left to right, e.g. "A|  12|  -3|...".
+ *
+ * @param size Size of @p buf, at least CHESSBOARD_RENDER_BOARD_SIZE.
+ *
+ * @return Length of the nul terminated text, or -ENOSPC if @p buf is too small.
+ */
+int chessboard_render_files(char *buf, size_t size, const struct chessboard_frame *frame,
+			    chessboard_render_value_t get_value);
+
+/* Character of a CHESS_PIECE_* value as in FEN, upper case for white, '.' for no piece */
+char chessboard_render_piece(uint8_t piece);
+
+/**
+ * Render a state change of a square as one line, the new state and the square, e.g. "+E2".
+ *
+ * @param size Size of @p buf, at least CHESSBOARD_RENDER_LINE_SIZE.
+ *
+ * @return Length of the nul terminated text, or -ENOSPC if @p buf is too small.
+ */
+int chessboard_render_event(char *buf, size_t size, const struct chessboard_event *event);
+
+/**
+ * Render a move as one line, the move number and the move in coordinate notation, e.g. "1. e2e4"
+ * or "12... e7e8q+", or the rejection of an illegal or ambiguous position.
+ *
+ * @param size Size of @p buf, at least CHESSBOARD_RENDER_LINE_SIZE.
+ *
+ * @return Length of the nul terminated text, or -ENOSPC if @p buf is too small.
+ */
+int chessboard_render_move(char *buf, size_t size, const struct chessboard_move *move);
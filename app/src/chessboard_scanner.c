@@ -0,0 +1,656 @@
+#include "chessboard_scanner.h"
+#include "chessboard_boot.h"
+#include "chessboard_calibration.h"
+#include "chessboard_detect.h"
+#include "chessboard_filter.h"
+#include "chessboard_game.h"
+#include "chessboard_recorder.h"
+#include "chessboard_stats.h"
+#include "watchdog.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(chessboard_scanner, LOG_LEVEL_INF);
+
+#define SCANNER_STACK_SIZE        1536
+#define SCANNER_PRIORITY          10
+#define SCANNER_DEFAULT_PERIOD_MS 5
+#define SCANNER_ERROR_BACKOFF_MS  100
+/* The board resets if no scan completes for this long, e.g. the ADC keeps failing or a higher
+ * priority thread hogs the CPU. Long above the idle sentinel period.
+ */
+#define SCANNER_WDT_TIMEOUT_MS    500
+/* A file stays active this long after the last state change of one of its squares */
+#define SCANNER_ACTIVE_HOLD_MS    2000
+/* Switch to idle mode after this long without any state change */
+#define SCANNER_IDLE_TIMEOUT_MS      30000
+/* Period of the precise scans in idle mode, the sentinel scans use the fast setting */
+#define SCANNER_IDLE_FULL_REFRESH_MS 2000
+
+/* Frames are double buffered. The scanner always writes the slot that is not the latest one, and
+ * each slot carries a sequence lock that is odd while it is being written, so readers can detect a
+ * copy that raced with the writer and retry on the then latest slot.
+ */
+struct frame_slot {
+	atomic_t lock;
+	struct chessboard_frame frame;
+};
+
+static struct frame_slot frame_slots[2];
+
+ZBUS_CHAN_DEFINE(chessboard_frame_chan, struct chessboard_frame, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+		 ZBUS_MSG_INIT(0));
+static atomic_t latest_slot = ATOMIC_INIT(-1);
+static atomic_t latest_seq;
+
+static atomic_t scan_period_ms = ATOMIC_INIT(SCANNER_DEFAULT_PERIOD_MS);
+static atomic_t active_files;
+static atomic_t scan_profile = ATOMIC_INIT(CHESSBOARD_SCANNER_PROFILE_PRECISE);
+static atomic_t wake_requested;
+
+/* Only used by the scanner thread */
+static uint32_t file_scanned_ms[CHESS_NUM_FILES];
+static uint32_t file_active_ms[CHESS_NUM_FILES];
+static uint32_t last_change_ms;
+static uint32_t idle_full_scan_ms;
+static uint32_t idle_quiet_scan_ms;
+/* Raw counts of the scans of this thread, a square keeps its value until it is scanned again */
+static int16_t scan_raw[CHESS_NUM_SQUARES];
+
+/* Mode and statistics, written by the scanner thread */
+static struct k_spinlock stats_lock;
+static uint8_t scanner_mode = CHESSBOARD_SCANNER_MODE_ACTIVE;
+static struct chessboard_scanner_stats scanner_stats;
+static uint32_t mode_entered_ms;
+static uint64_t mode_busy_cycles[CHESSBOARD_SCANNER_NUM_MODES];
+static uint64_t mode_all_cycles[CHESSBOARD_SCANNER_NUM_MODES];
+static uint64_t accounted_busy_cycles;
+static uint64_t accounted_all_cycles;
+
+static K_MUTEX_DEFINE(frame_wait_lock);
+static K_CONDVAR_DEFINE(frame_wait_cond);
+
+static struct k_spinlock subscribers_lock;
+static struct k_poll_signal *subscribers[CHESSBOARD_SCANNER_MAX_SUBSCRIBERS];
+
+int chessboard_get_frame(struct chessboard_frame *frame)
+{
+	while (1) {
+		const atomic_val_t slot = atomic_get(&latest_slot);
+
+		if (slot < 0) {
+			return -EAGAIN;
+		}
+
+		const atomic_val_t begin = atomic_get(&frame_slots[slot].lock);
+
+		if (begin & 1) {
+			/* The writer moved on to this slot, so the other one is now the latest */
+			continue;
+		}
+
+		memcpy(frame, &frame_slots[slot].frame, sizeof(*frame));
+
+		if (atomic_get(&frame_slots[slot].lock) == begin) {
+			return 0;
+		}
+	}
+}
+
+int chessboard_wait_frame(struct chessboard_frame *frame, uint32_t after_seq, k_timeout_t timeout)
+{
+	k_mutex_lock(&frame_wait_lock, K_FOREVER);
+	if ((int32_t)((uint32_t)atomic_get(&latest_seq) - after_seq) <= 0) {
+		k_condvar_wait(&frame_wait_cond, &frame_wait_lock, timeout);
+	}
+	k_mutex_unlock(&frame_wait_lock);
+
+	if ((int32_t)((uint32_t)atomic_get(&latest_seq) - after_seq) <= 0) {
+		return -EAGAIN;
+	}
+
+	return chessboard_get_frame(frame);
+}
+
+int chessboard_scanner_subscribe(struct k_poll_signal *signal)
+{
+	int ret = -ENOMEM;
+
+	K_SPINLOCK(&subscribers_lock) {
+		for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+			if (subscribers[i] == NULL) {
+				subscribers[i] = signal;
+				ret = 0;
+				break;
+			}
+		}
+	}
+	return ret;
+}
+
+void chessboard_scanner_unsubscribe(struct k_poll_signal *signal)
+{
+	K_SPINLOCK(&subscribers_lock) {
+		for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+			if (subscribers[i] == signal) {
+				subscribers[i] = NULL;
+			}
+		}
+	}
+}
+
+int32_t chessboard_frame_get_raw(const struct chessboard_frame *frame, uint8_t file, uint8_t rank)
+{
+	if (file > 7 || rank > 7) {
+		return -1;
+	}
+
+	return frame->raw[CHESS_SQUARE(file, rank)];
+}
+
+int32_t chessboard_frame_get_offset(const struct chessboard_frame *frame, uint8_t file,
+				    uint8_t rank)
+{
+	if (file > 7 || rank > 7) {
+		return -1;
+	}
+
+	return chessboard_calibration_get_raw(file, rank) - frame->raw[CHESS_SQUARE(file, rank)];
+}
+
+int32_t chessboard_frame_get_mv(const struct chessboard_frame *frame, uint8_t file, uint8_t rank)
+{
+	if (file > 7 || rank > 7) {
+		return -1;
+	}
+
+	return chessboard_raw_to_mv(frame->raw[CHESS_SQUARE(file, rank)]);
+}
+
+int32_t chessboard_frame_get_mv_offset(const struct chessboard_frame *frame, uint8_t file,
+				       uint8_t rank)
+{
+	if (file > 7 || rank > 7) {
+		return -1;
+	}
+
+	return chessboard_raw_to_mv(chessboard_frame_get_offset(frame, file, rank));
+}
+
+void chessboard_scanner_set_period(uint32_t period_ms)
+{
+	atomic_set(&scan_period_ms, period_ms);
+}
+
+uint32_t chessboard_scanner_get_period(void)
+{
+	return (uint32_t)atomic_get(&scan_period_ms);
+}
+
+int chessboard_scanner_set_profile(uint8_t profile)
+{
+	if (profile >= CHESSBOARD_SCANNER_NUM_PROFILES) {
+		return -EINVAL;
+	}
+
+	atomic_set(&scan_profile, profile);
+	return 0;
+}
+
+uint8_t chessboard_scanner_get_profile(void)
+{
+	return (uint8_t)atomic_get(&scan_profile);
+}
+
+uint8_t chessboard_scanner_get_active_files(void)
+{
+	return (uint8_t)atomic_get(&active_files);
+}
+
+void chessboard_scanner_wake(void)
+{
+	atomic_set(&wake_requested, 1);
+}
+
+/* Add the time since the last call to the current mode, with stats_lock held */
+static void account_mode_time(void)
+{
+	const uint32_t now_ms = k_uptime_get_32();
+
+	scanner_stats.mode_time_ms[scanner_mode] += now_ms - mode_entered_ms;
+	mode_entered_ms = now_ms;
+
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+	k_thread_runtime_stats_t usage;
+
+	if (k_thread_runtime_stats_all_get(&usage) == 0) {
+		/* total_cycles excludes the idle thread, execution_cycles includes it */
+		mode_busy_cycles[scanner_mode] += usage.total_cycles - accounted_busy_cycles;
+		mode_all_cycles[scanner_mode] += usage.execution_cycles - accounted_all_cycles;
+		accounted_busy_cycles = usage.total_cycles;
+		accounted_all_cycles = usage.execution_cycles;
+	}
+#endif
+}
+
+static void set_mode(uint8_t mode)
+{
+	K_SPINLOCK(&stats_lock) {
+		account_mode_time();
+		scanner_mode = mode;
+	}
+	LOG_INF("Scanner %s", (mode == CHESSBOARD_SCANNER_MODE_IDLE) ? "idle" : "active");
+}
+
+void chessboard_scanner_get_stats(struct chessboard_scanner_stats *stats)
+{
+	K_SPINLOCK(&stats_lock) {
+		account_mode_time();
+		scanner_stats.mode = scanner_mode;
+		for (int mode = 0; mode < CHESSBOARD_SCANNER_NUM_MODES; mode++) {
+			scanner_stats.cpu_load[mode] =
+				(mode_all_cycles[mode] == 0)
+					? 0
+					: (uint16_t)((mode_busy_cycles[mode] * 10000) /
+						     mode_all_cycles[mode]);
+		}
+		*stats = scanner_stats;
+	}
+}
+
+void chessboard_scanner_reset_stats(void)
+{
+	K_SPINLOCK(&stats_lock) {
+		account_mode_time();
+		memset(&scanner_stats, 0, sizeof(scanner_stats));
+		memset(mode_busy_cycles, 0, sizeof(mode_busy_cycles));
+		memset(mode_all_cycles, 0, sizeof(mode_all_cycles));
+	}
+}
+
+/* Files scanned per period in active mode, per profile. With the precise setting at the default
+ * period this is the same ADC load as a full scan every 20 ms. A read with the fast setting costs
+ * a fraction of a precise one, so fast sweeps cover the whole board every period instead.
+ */
+static const uint8_t files_per_scan[CHESSBOARD_SCANNER_NUM_PROFILES] = {
+	[CHESSBOARD_SCANNER_PROFILE_PRECISE] = 2,
+	[CHESSBOARD_SCANNER_PROFILE_FAST] = CHESS_NUM_FILES,
+	[CHESSBOARD_SCANNER_PROFILE_CONFIRM] = CHESS_NUM_FILES,
+};
+
+/* Pick the files to scan next, bit n is file n.
+ *
+ * Files that would otherwise exceed the full refresh period before the next scan always go
+ * first, even beyond the budget of @p budget files. The rest of the budget goes to the active
+ * files and then to the quiet ones, the longest unscanned first.
+ *
+ * Each file is one ADC channel and the plan walks the multiplexer codes of consecutive files in
+ * opposite Gray code directions, so any batch of files costs one channel setup per file and at
+ * most one select line toggle per step.
+ */
+static uint8_t schedule_files(uint32_t now_ms, uint32_t period_ms, int budget)
+{
+	const uint8_t active = (uint8_t)atomic_get(&active_files);
+	uint8_t selected = 0;
+	int count = 0;
+
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		if ((now_ms - file_scanned_ms[file]) + period_ms >=
+		    CHESSBOARD_SCANNER_FULL_REFRESH_MS) {
+			selected |= BIT(file);
+			count++;
+		}
+	}
+
+	for (int pass = 0; pass < 2; pass++) {
+		const uint8_t candidates = (pass == 0) ? active : (uint8_t)~active;
+
+		while (count < budget) {
+			int best = -1;
+
+			for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+				if ((selected & BIT(file)) || !(candidates & BIT(file))) {
+					continue;
+				}
+				if ((best < 0) || ((now_ms - file_scanned_ms[file]) >
+						   (now_ms - file_scanned_ms[best]))) {
+					best = file;
+				}
+			}
+
+			if (best < 0) {
+				break;
+			}
+			selected |= BIT(best);
+			count++;
+		}
+	}
+
+	return selected;
+}
+
+static uint64_t files_to_squares(uint8_t files)
+{
+	uint64_t mask = 0;
+
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		if (files & BIT(file)) {
+			mask |= CHESS_FILE_MASK(file);
+		}
+	}
+	return mask;
+}
+
+/* Mark the files with a state change as active, and expire the ones that went quiet */
+static void update_activity(uint64_t changed, uint32_t now_ms)
+{
+	/* Fold the ranks onto each other, leaving bit n set if any square of file n changed */
+	changed |= changed >> 32;
+	changed |= changed >> 16;
+	changed |= changed >> 8;
+
+	uint8_t active = (uint8_t)atomic_get(&active_files) | (uint8_t)changed;
+
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		if ((uint8_t)changed & BIT(file)) {
+			file_active_ms[file] = now_ms;
+		} else if ((now_ms - file_active_ms[file]) >= SCANNER_ACTIVE_HOLD_MS) {
+			active &= ~BIT(file);
+		}
+	}
+
+	atomic_set(&active_files, active);
+}
+
+static const struct chessboard_frame *publish_frame(uint64_t scanned, uint64_t unfiltered)
+{
+	const atomic_val_t slot = (atomic_get(&latest_slot) + 1) & 1;
+	struct frame_slot *dst = &frame_slots[slot];
+
+	atomic_inc(&dst->lock);
+	dst->frame.seq = (uint32_t)atomic_get(&latest_seq) + 1;
+	dst->frame.timestamp_ms = k_uptime_get_32();
+	dst->frame.scanned = scanned;
+	memcpy(dst->frame.raw, scan_raw, sizeof(scan_raw));
+	chessboard_filter_apply(dst->frame.raw, scanned, unfiltered);
+	dst->frame.ready_cycles = k_cycle_get_32();
+	atomic_inc(&dst->lock);
+
+	atomic_set(&latest_slot, slot);
+	atomic_set(&latest_seq, dst->frame.seq);
+
+	k_mutex_lock(&frame_wait_lock, K_FOREVER);
+	k_condvar_broadcast(&frame_wait_cond);
+	k_mutex_unlock(&frame_wait_lock);
+
+	K_SPINLOCK(&subscribers_lock) {
+		for (int i = 0; i < ARRAY_SIZE(subscribers); i++) {
+			if (subscribers[i] != NULL) {
+				k_poll_signal_raise(subscribers[i], (int)dst->frame.seq);
+			}
+		}
+	}
+
+	/* One copy into the channel, however many observers there are. Never wait, the scan
+	 * schedule matters more than a reader that is still busy with the previous frame.
+	 */
+	if (zbus_chan_pub(&chessboard_frame_chan, &dst->frame, K_NO_WAIT) != 0) {
+		K_SPINLOCK(&stats_lock) {
+			scanner_stats.bus_drops++;
+		}
+	}
+
+	/* Stays untouched until the next frame is published by this thread */
+	return &dst->frame;
+}
+
+static int scan_frame(uint64_t mask)
+{
+	static struct k_poll_signal done = K_POLL_SIGNAL_INITIALIZER(done);
+	struct k_poll_event event =
+		K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &done);
+	unsigned int signaled;
+	int result;
+
+	k_poll_signal_reset(&done);
+	int ret = chessboard_scan_async(mask, scan_raw, &done);
+	if (ret != 0) {
+		return ret;
+	}
+
+	k_poll(&event, 1, K_FOREVER);
+	k_poll_signal_check(&done, &signaled, &result);
+	return result;
+}
+
+/* Scan the squares of a fast sweep of @p mask that came out close to a threshold again, with the
+ * precise setting. The others keep their fast reading.
+ */
+static int confirm_scan(uint64_t mask)
+{
+	const uint64_t uncertain = chessboard_detect_get_uncertain(
+		scan_raw, mask, chessboard_calibration_get_confirm_margins());
+
+	K_SPINLOCK(&stats_lock) {
+		scanner_stats.confirm_sweeps++;
+		scanner_stats.confirm_squares += (uint32_t)__builtin_popcountll(uncertain);
+	}
+
+	if (uncertain == 0) {
+		return 0;
+	}
+	chessboard_set_acquisition(CHESSBOARD_ACQUISITION_PRECISE);
+	return scan_frame(uncertain);
+}
+
+/* Pick the squares to scan in idle mode and the acquisition setting to scan them with */
+static uint64_t schedule_idle(uint32_t now_ms, uint8_t *acquisition)
+{
+	if ((now_ms - idle_full_scan_ms) >= SCANNER_IDLE_FULL_REFRESH_MS) {
+		idle_full_scan_ms = now_ms;
+		*acquisition = CHESSBOARD_ACQUISITION_PRECISE;
+		return CHESS_ALL_SQUARES;
+	}
+
+	/* A piece may be lifted from an occupied square or placed on an empty one, so the sentinel
+	 * scans watch them all
+	 */
+	*acquisition = CHESSBOARD_ACQUISITION_FAST;
+	return CHESS_ALL_SQUARES;
+}
+
+/* Switch between active and idle mode after a frame, returns true to scan again right away */
+static bool update_mode(uint64_t changed, uint32_t now_ms)
+{
+	if (changed != 0) {
+		last_change_ms = now_ms;
+	}
+
+	if (scanner_mode == CHESSBOARD_SCANNER_MODE_ACTIVE) {
+		if ((now_ms - last_change_ms) >= SCANNER_IDLE_TIMEOUT_MS) {
+			idle_full_scan_ms = now_ms;
+			idle_quiet_scan_ms = now_ms;
+			set_mode(CHESSBOARD_SCANNER_MODE_IDLE);
+		}
+		return false;
+	}
+
+	if (changed == 0) {
+		idle_quiet_scan_ms = now_ms;
+		return false;
+	}
+
+	K_SPINLOCK(&stats_lock) {
+		scanner_stats.wakes++;
+		scanner_stats.last_wake_latency_ms = now_ms - idle_quiet_scan_ms;
+		scanner_stats.max_wake_latency_ms = MAX(scanner_stats.max_wake_latency_ms,
+							scanner_stats.last_wake_latency_ms);
+	}
+	set_mode(CHESSBOARD_SCANNER_MODE_ACTIVE);
+	return true;
+}
+
+/* A scan that did not complete before the next one was due */
+static void count_deadline_miss(void)
+{
+	K_SPINLOCK(&stats_lock) {
+		scanner_stats.deadline_misses++;
+	}
+}
+
+/* How late the scan due at @p scheduled_ms actually started */
+static void account_jitter(int64_t scheduled_ms)
+{
+	const int64_t late_us = k_ticks_to_us_floor64(k_uptime_ticks()) - (scheduled_ms * 1000);
+	const uint32_t jitter_us = (uint32_t)CLAMP(late_us, 0, UINT32_MAX);
+
+	K_SPINLOCK(&stats_lock) {
+		scanner_stats.last_jitter_us = jitter_us;
+		scanner_stats.max_jitter_us = MAX(scanner_stats.max_jitter_us, jitter_us);
+	}
+}
+
+static void scanner_thread(void *p1, void *p2, void *p3)
+{
+	int64_t next_scan = k_uptime_get();
+	int prev_ret = 0;
+
+	chessboard_boot_mark(CHESSBOARD_BOOT_SCANNER);
+	/* Without a scan plan every scan fails for good, a reset loop would only hide the shell */
+	const int wdt_channel = chessboard_is_ready()
+					? watchdog_add_channel("scanner", SCANNER_WDT_TIMEOUT_MS)
+					: -ENODEV;
+	uint32_t scan_count = chessboard_get_scan_count();
+
+	if (wdt_channel == -ENODEV) {
+		LOG_ERR("No scan plan, the scanner is not supervised");
+	}
+
+	last_change_ms = (uint32_t)next_scan;
+	mode_entered_ms = (uint32_t)next_scan;
+	for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+		/* Start with a full scan */
+		file_scanned_ms[file] = (uint32_t)next_scan - CHESSBOARD_SCANNER_FULL_REFRESH_MS;
+	}
+
+	while (1) {
+		const uint32_t now_ms = k_uptime_get_32();
+		const uint32_t start_cycles = k_cycle_get_32();
+		uint8_t acquisition = CHESSBOARD_ACQUISITION_PRECISE;
+		bool confirm = false;
+		uint32_t period_ms;
+		uint8_t files = 0;
+		uint64_t unfiltered = 0;
+		uint64_t mask;
+		int ret = 0;
+
+		if (atomic_clear(&wake_requested)) {
+			/* Like a change of the board, active for the idle timeout from now */
+			last_change_ms = now_ms;
+			if (scanner_mode == CHESSBOARD_SCANNER_MODE_IDLE) {
+				set_mode(CHESSBOARD_SCANNER_MODE_ACTIVE);
+			}
+		}
+
+		if (scanner_mode == CHESSBOARD_SCANNER_MODE_IDLE) {
+			period_ms = CHESSBOARD_SCANNER_SENTINEL_PERIOD_MS;
+			mask = schedule_idle(now_ms, &acquisition);
+			if (acquisition == CHESSBOARD_ACQUISITION_FAST) {
+				/* A changed square has to cross its threshold in this very scan,
+				 * not after the filter caught up over several sentinel periods
+				 */
+				unfiltered = mask;
+			}
+		} else {
+			const uint8_t profile = chessboard_scanner_get_profile();
+
+			period_ms = chessboard_scanner_get_period();
+			files = schedule_files(now_ms, period_ms, files_per_scan[profile]);
+			mask = files_to_squares(files);
+
+			if (profile != CHESSBOARD_SCANNER_PROFILE_PRECISE) {
+				acquisition = CHESSBOARD_ACQUISITION_FAST;
+				confirm = (profile == CHESSBOARD_SCANNER_PROFILE_CONFIRM);
+			}
+		}
+
+		if (mask != 0) {
+			chessboard_set_acquisition(acquisition);
+			ret = scan_frame(mask);
+			if (ret == 0 && confirm) {
+				ret = confirm_scan(mask);
+			}
+		}
+
+		if (ret == -EBUSY) {
+			/* Someone else is scanning, e.g. a 'board fps' measurement. Fed only while
+			 * their scans complete, so a scan lock that is never released still resets
+			 * the board.
+			 */
+			const uint32_t count = chessboard_get_scan_count();
+
+			if (count != scan_count) {
+				scan_count = count;
+				watchdog_feed(wdt_channel);
+			}
+			k_msleep(1);
+			continue;
+		}
+
+		if (ret == 0) {
+			scan_count = chessboard_get_scan_count();
+			watchdog_feed(wdt_channel);
+		}
+
+		if (ret == 0 && mask != 0) {
+			const struct chessboard_frame *frame = publish_frame(mask, unfiltered);
+			struct chessboard_bitboards bb;
+
+			for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+				if (files & BIT(file)) {
+					file_scanned_ms[file] = frame->timestamp_ms;
+				}
+			}
+
+			chessboard_detect_process(frame);
+			chessboard_boot_mark(CHESSBOARD_BOOT_FIRST_FRAME);
+			chessboard_get_bitboards(&bb);
+			update_activity(bb.changed, frame->timestamp_ms);
+			chessboard_game_process(&bb, frame->timestamp_ms);
+			chessboard_recorder_record(frame);
+			chessboard_stats_add_frame(start_cycles);
+
+			if (update_mode(bb.changed, frame->timestamp_ms)) {
+				/* Woken up, continue at full rate right away */
+				next_scan = k_uptime_get();
+				continue;
+			}
+		} else if (ret != 0 && ret != prev_ret) {
+			LOG_ERR("Scan failed: %d", ret);
+		}
+		prev_ret = ret;
+
+		next_scan += (ret == 0) ? period_ms : SCANNER_ERROR_BACKOFF_MS;
+
+		const int64_t now = k_uptime_get();
+
+		if (next_scan < now) {
+			/* Scanning takes longer than the period, start over right away */
+			if (ret == 0 && period_ms != 0) {
+				count_deadline_miss();
+			}
+			next_scan = now;
+		} else {
+			/* Tickless sleep, the CPU idles until the next scan is due */
+			k_sleep(K_TIMEOUT_ABS_MS(next_scan));
+			account_jitter(next_scan);
+		}
+	}
+}
+
+K_THREAD_DEFINE(chessboard_scanner, SCANNER_STACK_SIZE, scanner_thread, NULL, NULL, NULL,
+		SCANNER_PRIORITY, 0, 0);
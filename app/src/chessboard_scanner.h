@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+#include "chessboard.h"
+
+/*
+ * A consistent view of the board. The scanner does not acquire every square for every frame:
+ * files with recent activity are scanned at the scan period, quiet files less often but at least
+ * once per CHESSBOARD_SCANNER_FULL_REFRESH_MS. Squares that were not acquired repeat their
+ * previous value.
+ */
+struct chessboard_frame {
+	/* Incremented for every published frame, starting at 1 */
+	uint32_t seq;
+	/* Uptime in milliseconds when the scan completed */
+	uint32_t timestamp_ms;
+	/* Squares acquired for this frame, bit n is CHESS_SQUARE() n */
+	uint64_t scanned;
+	/* Cycle counter when the frame was complete, to measure the time until consumers see it */
+	uint32_t ready_cycles;
+	/* Filtered raw counts, see chessboard_get_raw() */
+	int16_t raw[CHESS_NUM_SQUARES];
+};
+
+/*
+ * Every published frame, for any number of consumers. The scanner publishes each frame once,
+ * listeners run in the scanner thread right after and read the message in place with
+ * zbus_chan_const_msg(), so they have to be quick. Subscribers read it with zbus_chan_read(). A
+ * frame is dropped from the channel, and counted in bus_drops, if a reader still holds it.
+ */
+ZBUS_CHAN_DECLARE(chessboard_frame_chan);
+
+/* Number of signals that can be raised for every published frame */
+#define CHESSBOARD_SCANNER_MAX_SUBSCRIBERS 4
+
+/* Worst case age of any square in a published frame while active, as long as the scans keep up */
+#define CHESSBOARD_SCANNER_FULL_REFRESH_MS 60
+
+/* Scan at the scan period, prioritising active files */
+#define CHESSBOARD_SCANNER_MODE_ACTIVE ((uint8_t)0u)
+/* Nothing changed for a while: the board is scanned with the fast acquisition setting and at a
+ * low rate, plus an occasional precise scan. Any change switches back to active.
+ */
+#define CHESSBOARD_SCANNER_MODE_IDLE   ((uint8_t)1u)
+#define CHESSBOARD_SCANNER_NUM_MODES   2
+
+/* Period of the sentinel scans of all squares in idle mode, a lifted or placed piece is reported
+ * within this time
+ */
+#define CHESSBOARD_SCANNER_SENTINEL_PERIOD_MS 100
+
+/* Active mode scans with the precise acquisition setting. Idle mode keeps its own settings
+ * whatever the profile.
+ */
+#define CHESSBOARD_SCANNER_PROFILE_PRECISE ((uint8_t)0u)
+/* Active mode scans with the fast acquisition setting only */
+#define CHESSBOARD_SCANNER_PROFILE_FAST    ((uint8_t)1u)
+/* A fast sweep, then the squares within their confirm margin of a threshold are scanned again
+ * with the precise setting before the frame is published, see
+ * chessboard_calibration_get_confirm_margins()
+ */
+#define CHESSBOARD_SCANNER_PROFILE_CONFIRM ((uint8_t)2u)
+#define CHESSBOARD_SCANNER_NUM_PROFILES    3
+
+struct chessboard_scanner_stats {
+	uint8_t mode;
+	/* Number of switches from idle to active */
+	uint32_t wakes;
+	/* Time from the last idle scan without a change to the scan that saw the change, an upper
+	 * bound on the time from touching a piece to its first event
+	 */
+	uint32_t last_wake_latency_ms;
+	uint32_t max_wake_latency_ms;
+	/* Time spent in each mode */
+	uint32_t mode_time_ms[CHESSBOARD_SCANNER_NUM_MODES];
+	/* Share of the time in each mode the CPU was not idle, in 1/10000, or 0 without
+	 * CONFIG_SCHED_THREAD_USAGE_ALL
+	 */
+	uint16_t cpu_load[CHESSBOARD_SCANNER_NUM_MODES];
+	/* Scans that took longer than the scan period, so the next one started late */
+	uint32_t deadline_misses;
+	/* Delay from the time a scan was due until the scanner woke up for it, in microseconds */
+	uint32_t last_jitter_us;
+	uint32_t max_jitter_us;
+	/* Frames not published on chessboard_frame_chan because a reader held the channel */
+	uint32_t bus_drops;
+	/* Fast sweeps of the confirm profile, and the squares they scanned again precisely */
+	uint32_t confirm_sweeps;
+	uint32_t confirm_squares;
+};
+
+/**
+ * Copy the latest published frame. Never blocks the scanner, readers retry if the frame was
+ * replaced while being copied.
+ *
+ * @return 0 on success, -EAGAIN if no frame has been published yet.
+ */
+int chessboard_get_frame(struct chessboard_frame *frame);
+
+/**
+ * Wait for a frame newer than @p after_seq and copy it.
+ *
+ * @return 0 on success, -EAGAIN if no such frame was published within @p timeout.
+ */
+int chessboard_wait_frame(struct chessboard_frame *frame, uint32_t after_seq, k_timeout_t timeout);
+
+/**
+ * Raise @p signal, with the sequence number of the frame as result, whenever a frame is published.
+ * Lets a k_poll() or k_work_poll waiter react to frames without holding up the scanner.
+ *
+ * @return 0 on success, -ENOMEM if all subscriber slots are in use.
+ */
+int chessboard_scanner_subscribe(struct k_poll_signal *signal);
+void chessboard_scanner_unsubscribe(struct k_poll_signal *signal);
+
+int32_t chessboard_frame_get_raw(const struct chessboard_frame *frame, uint8_t file, uint8_t rank);
+/* Offset from calibration in raw counts */
+int32_t chessboard_frame_get_offset(const struct chessboard_frame *frame, uint8_t file,
+				    uint8_t rank);
+/* The same in millivolts, converted on every call, for output only */
+int32_t chessboard_frame_get_mv(const struct chessboard_frame *frame, uint8_t file, uint8_t rank);
+int32_t chessboard_frame_get_mv_offset(const struct chessboard_frame *frame, uint8_t file,
+				       uint8_t rank);
+
+/* Minimum time between the start of two scans, 0 scans back to back */
+void chessboard_scanner_set_period(uint32_t period_ms);
+uint32_t chessboard_scanner_get_period(void);
+
+/* Select the CHESSBOARD_SCANNER_PROFILE_* of the next scans, returns -EINVAL if unknown */
+int chessboard_scanner_set_profile(uint8_t profile);
+uint8_t chessboard_scanner_get_profile(void);
+
+/* Files the scheduler currently treats as active, bit n is file n */
+uint8_t chessboard_scanner_get_active_files(void);
+
+/* Switch to active mode with the next scan, within a sentinel period, and stay there for the idle
+ * timeout as if the board changed. Frames are then published at the full rate even on an empty
+ * board.
+ */
+void chessboard_scanner_wake(void);
+
+void chessboard_scanner_get_stats(struct chessboard_scanner_stats *stats);
+void chessboard_scanner_reset_stats(void);
@@ -0,0 +1,374 @@
+#include "chessboard_sim.h"
+#include "chessboard.h"
+#include "chessboard_calibration.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+LOG_MODULE_REGISTER(chessboard_sim, LOG_LEVEL_INF);
+
+#define SIM_STACK_SIZE 2048
+#define SIM_PRIORITY   12
+
+#define SIM_SUPPLY_MV          3300
+/* Sensor output without a magnet, and the spread between sensors */
+#define SIM_BASELINE_MV        1650
+#define SIM_BASELINE_SPREAD_MV 30
+#define SIM_DEFAULT_FIELD_MV   200
+#define SIM_DEFAULT_SEED       1
+
+#define SIM_MAX_LINE_LEN 96
+#define SIM_MAX_ARGS     4
+
+#define DT_SPEC_AND_COMMA(node_id, prop, idx) ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
+
+static const struct adc_dt_spec adc_channels[] = {
+	DT_FOREACH_PROP_ELEM(DT_PATH(zephyr_user), io_channels, DT_SPEC_AND_COMMA)};
+
+static const struct gpio_dt_spec select_pins[] = {
+	GPIO_DT_SPEC_GET(DT_ALIAS(channel_select_a), gpios),
+	GPIO_DT_SPEC_GET(DT_ALIAS(channel_select_b), gpios),
+	GPIO_DT_SPEC_GET(DT_ALIAS(channel_select_c), gpios),
+};
+
+/* Scenario file, see app/sim/ */
+static const char scenario[] = {
+#include "chessboard_sim_scenario.inc"
+	0x00,
+};
+
+struct sim_model {
+	/* CHESSBOARD_SIM_* per square */
+	int8_t piece[CHESS_NUM_SQUARES];
+	int16_t baseline_mv[CHESS_NUM_SQUARES];
+	uint16_t field_mv;
+	/* Uniform noise amplitude of every sample */
+	uint16_t noise_mv;
+	/* Common drift of all sensors, drift_uv at drift_since_ms plus drift_uv_per_s since then */
+	int32_t drift_uv_per_s;
+	int64_t drift_uv;
+	uint32_t drift_since_ms;
+	uint32_t rng;
+};
+
+static struct k_spinlock sim_lock;
+static struct sim_model model;
+
+/* xorshift32, deterministic for a given seed */
+static uint32_t sim_random(void)
+{
+	uint32_t x = model.rng;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	model.rng = x;
+	return x;
+}
+
+static void sim_seed(uint32_t seed)
+{
+	K_SPINLOCK(&sim_lock) {
+		/* xorshift never leaves 0 */
+		model.rng = (seed != 0) ? seed : SIM_DEFAULT_SEED;
+		for (int i = 0; i < CHESS_NUM_SQUARES; i++) {
+			model.baseline_mv[i] =
+				SIM_BASELINE_MV +
+				(int16_t)(sim_random() % (2 * SIM_BASELINE_SPREAD_MV + 1)) -
+				SIM_BASELINE_SPREAD_MV;
+		}
+	}
+}
+
+static int64_t drift_at(uint32_t now_ms)
+{
+	return model.drift_uv + ((int64_t)model.drift_uv_per_s * (now_ms - model.drift_since_ms)) / 1000;
+}
+
+/* Called by the ADC emulator for every sample of a channel */
+static int sim_adc_value(const struct device *dev, unsigned int chan, void *data, uint32_t *result)
+{
+	const uint8_t adc_index = (uint8_t)(uintptr_t)data;
+	uint8_t mux_code = 0;
+	bool inverted;
+	int32_t mv;
+
+	for (int i = 0; i < ARRAY_SIZE(select_pins); i++) {
+		const int level = gpio_emul_output_get(select_pins[i].port, select_pins[i].pin);
+
+		if (level < 0) {
+			return level;
+		}
+		mux_code |= (level ? 1 : 0) << i;
+	}
+
+	const int square = chessboard_mux_to_square(adc_index, mux_code, &inverted);
+	if (square < 0) {
+		return square;
+	}
+
+	K_SPINLOCK(&sim_lock) {
+		mv = model.baseline_mv[square] + (int32_t)(drift_at(k_uptime_get_32()) / 1000);
+		/* A white piece pulls the sensor output down, or up on the inverted files */
+		mv += (inverted ? 1 : -1) * model.piece[square] * model.field_mv;
+		if (model.noise_mv > 0) {
+			mv += (int32_t)(sim_random() % (2 * model.noise_mv + 1)) - model.noise_mv;
+		}
+	}
+
+	*result = CLAMP(mv, 0, SIM_SUPPLY_MV);
+	return 0;
+}
+
+void chessboard_sim_set_piece(uint8_t square, int8_t piece)
+{
+	if (square >= CHESS_NUM_SQUARES) {
+		return;
+	}
+
+	K_SPINLOCK(&sim_lock) {
+		model.piece[square] = piece;
+	}
+}
+
+static void sim_setup_position(void)
+{
+	K_SPINLOCK(&sim_lock) {
+		memset(model.piece, CHESSBOARD_SIM_EMPTY, sizeof(model.piece));
+		for (uint8_t file = 0; file < CHESS_NUM_FILES; file++) {
+			model.piece[CHESS_SQUARE(file, 0)] = CHESSBOARD_SIM_WHITE;
+			model.piece[CHESS_SQUARE(file, 1)] = CHESSBOARD_SIM_WHITE;
+			model.piece[CHESS_SQUARE(file, 6)] = CHESSBOARD_SIM_BLACK;
+			model.piece[CHESS_SQUARE(file, 7)] = CHESSBOARD_SIM_BLACK;
+		}
+	}
+}
+
+static int parse_square(const char *name, uint8_t *square)
+{
+	const int file = (name[0] >= 'a') ? (name[0] - 'a') : (name[0] - 'A');
+	const int rank = name[1] - '1';
+
+	if (file < 0 || file >= CHESS_NUM_FILES || rank < 0 || rank >= CHESS_NUM_RANKS ||
+	    name[2] != '\0') {
+		return -EINVAL;
+	}
+
+	*square = CHESS_SQUARE(file, rank);
+	return 0;
+}
+
+static int parse_colour(const char *name, int8_t *piece)
+{
+	if (strcmp(name, "white") == 0) {
+		*piece = CHESSBOARD_SIM_WHITE;
+	} else if (strcmp(name, "black") == 0) {
+		*piece = CHESSBOARD_SIM_BLACK;
+	} else {
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int parse_number(const char *text, long *value)
+{
+	char *end;
+
+	*value = strtol(text, &end, 10);
+	return (end == text || *end != '\0') ? -EINVAL : 0;
+}
+
+int chessboard_sim_exec(size_t argc, char **argv)
+{
+	const char *cmd = argv[0];
+	uint8_t square;
+	uint8_t to;
+	int8_t piece;
+	long value;
+
+	if (strcmp(cmd, "clear") == 0 && argc == 1) {
+		K_SPINLOCK(&sim_lock) {
+			memset(model.piece, CHESSBOARD_SIM_EMPTY, sizeof(model.piece));
+		}
+	} else if (strcmp(cmd, "setup") == 0 && argc == 1) {
+		sim_setup_position();
+	} else if (strcmp(cmd, "place") == 0 && argc == 3) {
+		if (parse_square(argv[1], &square) != 0 || parse_colour(argv[2], &piece) != 0) {
+			return -EINVAL;
+		}
+		chessboard_sim_set_piece(square, piece);
+	} else if (strcmp(cmd, "lift") == 0 && argc == 2) {
+		if (parse_square(argv[1], &square) != 0) {
+			return -EINVAL;
+		}
+		chessboard_sim_set_piece(square, CHESSBOARD_SIM_EMPTY);
+	} else if (strcmp(cmd, "move") == 0 && argc == 3) {
+		/* Lift and place in one go, replacing a captured piece */
+		if (parse_square(argv[1], &square) != 0 || parse_square(argv[2], &to) != 0) {
+			return -EINVAL;
+		}
+		K_SPINLOCK(&sim_lock) {
+			model.piece[to] = model.piece[square];
+			model.piece[square] = CHESSBOARD_SIM_EMPTY;
+		}
+	} else if (strcmp(cmd, "noise") == 0 && argc == 2) {
+		if (parse_number(argv[1], &value) != 0 || value < 0 || value > UINT16_MAX) {
+			return -EINVAL;
+		}
+		K_SPINLOCK(&sim_lock) {
+			model.noise_mv = (uint16_t)value;
+		}
+	} else if (strcmp(cmd, "field") == 0 && argc == 2) {
+		if (parse_number(argv[1], &value) != 0 || value < 0 || value > UINT16_MAX) {
+			return -EINVAL;
+		}
+		K_SPINLOCK(&sim_lock) {
+			model.field_mv = (uint16_t)value;
+		}
+	} else if (strcmp(cmd, "drift") == 0 && argc == 2) {
+		/* Microvolts per second, applied from now on */
+		if (parse_number(argv[1], &value) != 0) {
+			return -EINVAL;
+		}
+		K_SPINLOCK(&sim_lock) {
+			const uint32_t now_ms = k_uptime_get_32();
+
+			model.drift_uv = drift_at(now_ms);
+			model.drift_since_ms = now_ms;
+			model.drift_uv_per_s = (int32_t)value;
+		}
+	} else if (strcmp(cmd, "seed") == 0 && argc == 2) {
+		if (parse_number(argv[1], &value) != 0) {
+			return -EINVAL;
+		}
+		sim_seed((uint32_t)value);
+	} else if (strcmp(cmd, "calibrate") == 0 && argc == 1) {
+		return chessboard_calibration_calibrate(CHESSBOARD_CALIBRATION_DEFAULT_FRAMES);
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static bool is_blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* Split a line into whitespace separated words in place, returns the number of words */
+static size_t split_words(char *line, char **words, size_t max_words)
+{
+	size_t count = 0;
+	char *p = line;
+
+	while (count < max_words) {
+		while (is_blank(*p)) {
+			p++;
+		}
+		if (*p == '\0' || *p == '#') {
+			break;
+		}
+
+		words[count++] = p;
+		while (*p != '\0' && !is_blank(*p)) {
+			p++;
+		}
+		if (*p == '\0') {
+			break;
+		}
+		*p++ = '\0';
+	}
+
+	return count;
+}
+
+/* Each scenario line is "<delay_ms> <command> [arguments]", '#' starts a comment */
+static void sim_thread(void *p1, void *p2, void *p3)
+{
+	const char *line = scenario;
+	unsigned int line_number = 0;
+
+	while (*line != '\0') {
+		const char *end = strchr(line, '\n');
+		const size_t len = (end != NULL) ? (size_t)(end - line) : strlen(line);
+		char buf[SIM_MAX_LINE_LEN];
+		char *words[SIM_MAX_ARGS + 1];
+		long delay_ms;
+
+		line_number++;
+		if (len >= sizeof(buf)) {
+			LOG_ERR("Scenario line %u too long", line_number);
+			return;
+		}
+		memcpy(buf, line, len);
+		buf[len] = '\0';
+		line = (end != NULL) ? end + 1 : line + len;
+
+		const size_t count = split_words(buf, words, ARRAY_SIZE(words));
+		if (count == 0) {
+			continue;
+		}
+
+		if (count < 2 || parse_number(words[0], &delay_ms) != 0 || delay_ms < 0) {
+			LOG_ERR("Scenario line %u: expected <delay_ms> <command>", line_number);
+			return;
+		}
+
+		k_msleep(delay_ms);
+
+		int ret = chessboard_sim_exec(count - 1, &words[1]);
+		if (ret != 0) {
+			LOG_ERR("Scenario line %u: %s failed (%d)", line_number, words[1], ret);
+		}
+	}
+
+	LOG_INF("Scenario complete after %u lines", line_number);
+}
+
+static int chessboard_sim_setup(void)
+{
+	model.field_mv = SIM_DEFAULT_FIELD_MV;
+	sim_seed(SIM_DEFAULT_SEED);
+
+	for (int i = 0; i < ARRAY_SIZE(adc_channels); i++) {
+		int ret = adc_emul_value_func_set(adc_channels[i].dev, adc_channels[i].channel_id,
+						  sim_adc_value, (void *)(uintptr_t)i);
+		if (ret != 0) {
+			LOG_ERR("Could not attach board model to channel #%d (%d)", i, ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+SYS_INIT(chessboard_sim_setup, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+K_THREAD_DEFINE(chessboard_sim, SIM_STACK_SIZE, sim_thread, NULL, NULL, NULL, SIM_PRIORITY, 0, 0);
+
+#if defined(CONFIG_SHELL)
+static int cmd_sim(const struct shell *sh, size_t argc, char **argv)
+{
+	int ret = chessboard_sim_exec(argc - 1, &argv[1]);
+
+	if (ret != 0) {
+		shell_error(sh, "%s failed (%d)", argv[1], ret);
+	}
+	return ret;
+}
+
+SHELL_CMD_ARG_REGISTER(sim, NULL,
+		       "Change the simulated board: sim clear | setup | place <square> "
+		       "<white|black> | lift <square> | move <from> <to> | noise <mV> | "
+		       "field <mV> | drift <uV/s> | seed <n> | calibrate",
+		       cmd_sim, 2, 2);
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Board model of the native_sim build. The emulated ADC returns the voltage of the square that
+ * the emulated multiplexer select pins point at, for pieces placed by a scenario file embedded at
+ * build time, or by the 'sim' shell command.
+ */
+
+#define CHESSBOARD_SIM_WHITE ((int8_t)1)
+#define CHESSBOARD_SIM_BLACK ((int8_t)-1)
+#define CHESSBOARD_SIM_EMPTY ((int8_t)0)
+
+/* Place a piece of the given CHESSBOARD_SIM_* colour, or remove it with CHESSBOARD_SIM_EMPTY */
+void chessboard_sim_set_piece(uint8_t square, int8_t piece);
+
+/**
+ * Run one scenario command, without the leading delay, e.g. {"place", "e4", "white"}.
+ *
+ * @return 0 on success, -EINVAL for unknown commands or bad arguments.
+ */
+int chessboard_sim_exec(size_t argc, char **argv);
@@ -0,0 +1,73 @@
+#include "chessboard_stats.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+/* Updated from the scanner thread, the system work queue, the ADC interrupt and any shell command
+ * that scans, so every update is a short critical section.
+ */
+static struct k_spinlock stats_lock;
+static struct chessboard_stats stats = {
+	.frame_min_us = UINT32_MAX,
+};
+
+void chessboard_stats_add(uint8_t phase, uint32_t start_cycles, uint32_t items)
+{
+	const uint32_t cycles = k_cycle_get_32() - start_cycles;
+
+	if (phase >= CHESSBOARD_STATS_NUM_PHASES) {
+		return;
+	}
+
+	K_SPINLOCK(&stats_lock) {
+		stats.phases[phase].items += items;
+		stats.phases[phase].cycles += cycles;
+	}
+}
+
+void chessboard_stats_add_frame(uint32_t start_cycles)
+{
+	const uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+	const int bin = MIN(31 - __builtin_clz(us | 1), CHESSBOARD_STATS_HISTOGRAM_BINS - 1);
+
+	K_SPINLOCK(&stats_lock) {
+		stats.frames++;
+		stats.frame_min_us = MIN(stats.frame_min_us, us);
+		stats.frame_max_us = MAX(stats.frame_max_us, us);
+		stats.frame_total_us += us;
+		stats.frame_histogram[bin]++;
+	}
+}
+
+void chessboard_stats_count_error(uint8_t channel, uint8_t flags)
+{
+	if (channel >= CHESS_NUM_FILES) {
+		return;
+	}
+
+	K_SPINLOCK(&stats_lock) {
+		if (flags & CHESSBOARD_STATS_ERROR_ADC) {
+			stats.adc_errors[channel]++;
+		}
+		if (flags & CHESSBOARD_STATS_ERROR_LOGGED) {
+			stats.logged_errors[channel]++;
+		}
+	}
+}
+
+void chessboard_stats_get(struct chessboard_stats *copy)
+{
+	K_SPINLOCK(&stats_lock) {
+		*copy = stats;
+	}
+}
+
+void chessboard_stats_reset(void)
+{
+	K_SPINLOCK(&stats_lock) {
+		memset(&stats, 0, sizeof(stats));
+		stats.frame_min_us = UINT32_MAX;
+	}
+}
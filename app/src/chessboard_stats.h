@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include "chessboard.h"
+
+/* Selecting a multiplexer input, i.e. toggling the select lines */
+#define CHESSBOARD_STATS_PHASE_MUX         ((uint8_t)0u)
+/* Configuring the ADC for another input channel */
+#define CHESSBOARD_STATS_PHASE_SETUP       ((uint8_t)1u)
+/* A single ADC conversion, including oversampling */
+#define CHESSBOARD_STATS_PHASE_CONVERSION  ((uint8_t)2u)
+/* Storing a raw sample */
+#define CHESSBOARD_STATS_PHASE_STORE       ((uint8_t)3u)
+/* Looking up the calibration offset of a square in the detection engine */
+#define CHESSBOARD_STATS_PHASE_CALIBRATION ((uint8_t)4u)
+#define CHESSBOARD_STATS_NUM_PHASES        5
+
+/* Bin n counts frames that took [2^n, 2^(n+1)) us, the last bin also the longer ones */
+#define CHESSBOARD_STATS_HISTOGRAM_BINS 16
+
+/* An ADC driver call failed */
+#define CHESSBOARD_STATS_ERROR_ADC    BIT(0)
+/* An error was logged */
+#define CHESSBOARD_STATS_ERROR_LOGGED BIT(1)
+
+struct chessboard_stats_phase {
+	/* Number of multiplexer switches, channel setups, conversions or squares */
+	uint32_t items;
+	uint64_t cycles;
+};
+
+struct chessboard_stats {
+	struct chessboard_stats_phase phases[CHESSBOARD_STATS_NUM_PHASES];
+	/* Scanner frames, from the start of the scan until the frame was fully processed */
+	uint32_t frames;
+	uint32_t frame_min_us;
+	uint32_t frame_max_us;
+	uint64_t frame_total_us;
+	uint32_t frame_histogram[CHESSBOARD_STATS_HISTOGRAM_BINS];
+	/* Per ADC channel, i.e. per file */
+	uint32_t adc_errors[CHESS_NUM_FILES];
+	uint32_t logged_errors[CHESS_NUM_FILES];
+};
+
+/**
+ * Account the cycles since @p start_cycles, a k_cycle_get_32() value, to a phase of the scan.
+ * Safe to call from interrupt context.
+ *
+ * @param items Number of items handled in that time, so short phases can be timed in bulk.
+ */
+void chessboard_stats_add(uint8_t phase, uint32_t start_cycles, uint32_t items);
+
+/* Account a frame that started at @p start_cycles and was fully processed now */
+void chessboard_stats_add_frame(uint32_t start_cycles);
+
+/* Count an error of ADC channel @p channel, flags are CHESSBOARD_STATS_ERROR_* */
+void chessboard_stats_count_error(uint8_t channel, uint8_t flags);
+
+void chessboard_stats_get(struct chessboard_stats *stats);
+void chessboard_stats_reset(void);
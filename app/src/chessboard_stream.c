@@ -0,0 +1,170 @@
+#include "chessboard_stream.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+static size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+	size_t code_index = 0;
+	size_t out = 1;
+	uint8_t code = 1;
+
+	for (size_t i = 0; i < len; i++) {
+		if (src[i] != 0) {
+			dst[out++] = src[i];
+			code++;
+		}
+
+		if ((src[i] == 0) || (code == 0xFF)) {
+			dst[code_index] = code;
+			code = 1;
+			code_index = out++;
+		}
+	}
+	dst[code_index] = code;
+	dst[out++] = 0;
+
+	return out;
+}
+
+static int16_t frame_value(const struct chessboard_frame *frame, uint8_t payload, uint8_t square)
+{
+	if (payload != CHESSBOARD_STREAM_PAYLOAD_OFFSET) {
+		return frame->raw[square];
+	}
+
+	/* Both in raw counts, at most 2 * 4095 apart */
+	return (int16_t)chessboard_frame_get_offset(frame, square % CHESS_NUM_FILES,
+						    square / CHESS_NUM_FILES);
+}
+
+int chessboard_stream_encode_frame(const struct chessboard_frame *frame, uint8_t payload,
+				   uint8_t *buf, size_t size)
+{
+	uint8_t packet[CHESSBOARD_STREAM_FRAME_SIZE];
+	uint8_t *p = packet;
+
+	if (size < CHESSBOARD_STREAM_ENCODED_SIZE(sizeof(packet))) {
+		return -ENOMEM;
+	}
+
+	*p++ = CHESSBOARD_STREAM_TYPE_FRAME;
+	*p++ = payload;
+	sys_put_le32(frame->seq, p);
+	p += 4;
+	sys_put_le32(frame->timestamp_ms, p);
+	p += 4;
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		sys_put_le16((uint16_t)frame_value(frame, payload, square), p);
+		p += 2;
+	}
+	sys_put_le16(crc16_ccitt(0xFFFF, packet, p - packet), p);
+
+	return (int)cobs_encode(packet, sizeof(packet), buf);
+}
+
+void chessboard_stream_delta_init(struct chessboard_stream_delta *delta, uint8_t payload,
+				  uint16_t keyframe_interval, uint16_t deadband)
+{
+	delta->payload = payload;
+	delta->keyframe_interval = MAX(keyframe_interval, 1);
+	delta->deadband = deadband;
+	delta->frames_since_keyframe = 0;
+	/* Start with a keyframe, sent[] is overwritten by it */
+	delta->keyframe_due = true;
+	memset(delta->sent, 0, sizeof(delta->sent));
+}
+
+int chessboard_stream_encode_delta(struct chessboard_stream_delta *delta,
+				   const struct chessboard_frame *frame, uint8_t *buf, size_t size)
+{
+	uint8_t packet[CHESSBOARD_STREAM_DELTA_SIZE];
+	uint8_t *p = packet;
+	uint64_t mask = 0;
+
+	if (size < CHESSBOARD_STREAM_ENCODED_SIZE(sizeof(packet))) {
+		return -ENOMEM;
+	}
+
+	/* Not counted on while a keyframe is due, so it never wraps at the maximum interval */
+	if (!delta->keyframe_due &&
+	    (++delta->frames_since_keyframe >= delta->keyframe_interval)) {
+		delta->keyframe_due = true;
+	}
+
+	if (delta->keyframe_due) {
+		int len = chessboard_stream_encode_frame(frame, delta->payload, buf, size);
+
+		if (len > 0) {
+			delta->frames_since_keyframe = 0;
+			delta->keyframe_due = false;
+			for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+				delta->sent[square] = frame_value(frame, delta->payload, square);
+			}
+		}
+		return len;
+	}
+
+	*p++ = CHESSBOARD_STREAM_TYPE_DELTA;
+	*p++ = delta->payload;
+	sys_put_le32(frame->seq, p);
+	p += 4;
+	sys_put_le32(frame->timestamp_ms, p);
+	p += 4;
+	uint8_t *mask_pos = p;
+	p += 8;
+
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		const int16_t value = frame_value(frame, delta->payload, square);
+
+		if (ABS((int32_t)value - delta->sent[square]) <= delta->deadband) {
+			continue;
+		}
+
+		mask |= BIT64(square);
+		delta->sent[square] = value;
+		sys_put_le16((uint16_t)value, p);
+		p += 2;
+	}
+
+	if (mask == 0) {
+		return 0;
+	}
+
+	sys_put_le64(mask, mask_pos);
+	sys_put_le16(crc16_ccitt(0xFFFF, packet, p - packet), p);
+	p += 2;
+
+	return (int)cobs_encode(packet, p - packet, buf);
+}
+
+int chessboard_stream_encode_recording(uint8_t format, uint16_t index, uint16_t count,
+				       const uint8_t *data, size_t len, uint8_t *buf, size_t size)
+{
+	uint8_t packet[CHESSBOARD_STREAM_RECORDING_SIZE];
+	uint8_t *p = packet;
+
+	if (len > CHESSBOARD_STREAM_CHUNK_SIZE) {
+		return -EINVAL;
+	}
+	if (size < CHESSBOARD_STREAM_ENCODED_SIZE(sizeof(packet))) {
+		return -ENOMEM;
+	}
+
+	*p++ = CHESSBOARD_STREAM_TYPE_RECORDING;
+	*p++ = format;
+	sys_put_le16(index, p);
+	p += 2;
+	sys_put_le16(count, p);
+	p += 2;
+	memcpy(p, data, len);
+	p += len;
+	sys_put_le16(crc16_ccitt(0xFFFF, packet, p - packet), p);
+	p += 2;
+
+	return (int)cobs_encode(packet, p - packet, buf);
+}
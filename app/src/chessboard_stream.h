@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chessboard_scanner.h"
+
+/*
+ * Binary frame stream packet, all fields little endian:
+ *
+ *   u8  type       CHESSBOARD_STREAM_TYPE_*
+ *   u8  payload    CHESSBOARD_STREAM_PAYLOAD_*, what the values are and their unit
+ *   u32 seq        frame sequence number
+ *   u32 timestamp  frame timestamp in milliseconds
+ *   i16 value[64]  CHESS_SQUARE() order, A1 first, raw ADC counts or offsets from calibration
+ *   u16 crc        crc16_ccitt() with seed 0xFFFF over all preceding bytes
+ *
+ * A delta packet (CHESSBOARD_STREAM_TYPE_DELTA) replaces the values by
+ *
+ *   u64 mask       bit n set if square n is included
+ *   i16 value[]    new value of every included square, in ascending square order
+ *
+ * Delta packets are only sent when at least one square moved more than the dead-band away from
+ * the value the host last received, and a full frame is sent as keyframe every
+ * keyframe_interval frames so a host can (re)join the stream at any time.
+ *
+ * A recording packet (CHESSBOARD_STREAM_TYPE_RECORDING) carries a chunk of a flight recording,
+ * see chessboard_recorder.h, instead of a frame:
+ *
+ *   u8  type       CHESSBOARD_STREAM_TYPE_RECORDING
+ *   u8  format     CHESSBOARD_RECORDER_FORMAT
+ *   u16 index      chunk number, starting at 0
+ *   u16 count      number of chunks of the recording
+ *   u8  data[]     up to CHESSBOARD_STREAM_CHUNK_SIZE bytes of the recording
+ *   u16 crc
+ *
+ * Each packet is COBS encoded and terminated by a zero byte, so a host can resynchronise on the
+ * next zero after any corruption or interleaved console output.
+ */
+#define CHESSBOARD_STREAM_TYPE_FRAME     ((uint8_t)0x01u)
+#define CHESSBOARD_STREAM_TYPE_DELTA     ((uint8_t)0x02u)
+#define CHESSBOARD_STREAM_TYPE_RECORDING ((uint8_t)0x03u)
+
+/* Values in raw ADC counts, and offsets from calibration in raw counts. Payloads 0 and 1 were
+ * the same in millivolts, they are no longer sent, so a host built for them rejects the packets
+ * instead of misreading the values.
+ */
+#define CHESSBOARD_STREAM_PAYLOAD_RAW    ((uint8_t)2u)
+#define CHESSBOARD_STREAM_PAYLOAD_OFFSET ((uint8_t)3u)
+
+#define CHESSBOARD_STREAM_FRAME_SIZE (2 + 4 + 4 + 2 * CHESS_NUM_SQUARES + 2)
+#define CHESSBOARD_STREAM_DELTA_SIZE (2 + 4 + 4 + 8 + 2 * CHESS_NUM_SQUARES + 2)
+#define CHESSBOARD_STREAM_CHUNK_SIZE 240
+#define CHESSBOARD_STREAM_RECORDING_SIZE (2 + 2 + 2 + CHESSBOARD_STREAM_CHUNK_SIZE + 2)
+
+/* Worst case size of an encoded packet of @p len bytes, including COBS overhead and delimiter */
+#define CHESSBOARD_STREAM_ENCODED_SIZE(len) ((len) + ((len) / 254) + 2)
+
+/**
+ * Encode a frame packet.
+ *
+ * @return Number of bytes written to @p buf, or -ENOMEM if @p size is too small.
+ */
+int chessboard_stream_encode_frame(const struct chessboard_frame *frame, uint8_t payload,
+				   uint8_t *buf, size_t size);
+
+/* State of a delta encoded stream */
+struct chessboard_stream_delta {
+	/* Values as last sent to the host */
+	int16_t sent[CHESS_NUM_SQUARES];
+	uint16_t keyframe_interval;
+	/* In raw counts */
+	uint16_t deadband;
+	uint16_t frames_since_keyframe;
+	uint8_t payload;
+	/* The next packet is a keyframe whatever the interval, e.g. the first one */
+	bool keyframe_due;
+};
+
+void chessboard_stream_delta_init(struct chessboard_stream_delta *delta, uint8_t payload,
+				  uint16_t keyframe_interval, uint16_t deadband);
+
+/**
+ * Encode a keyframe or a delta packet for the next frame.
+ *
+ * @return Number of bytes written to @p buf, 0 if nothing changed and no packet needs to be
+ *         sent, or -ENOMEM if @p size is too small.
+ */
+int chessboard_stream_encode_delta(struct chessboard_stream_delta *delta,
+				   const struct chessboard_frame *frame, uint8_t *buf, size_t size);
+
+/**
+ * Encode a recording packet with @p len bytes of @p data, at most CHESSBOARD_STREAM_CHUNK_SIZE.
+ *
+ * @return Number of bytes written to @p buf, -EINVAL if @p len is too large, or -ENOMEM if
+ *         @p size is too small.
+ */
+int chessboard_stream_encode_recording(uint8_t format, uint16_t index, uint16_t count,
+				       const uint8_t *data, size_t len, uint8_t *buf, size_t size);
@@ -5,15 +5,67 @@
 #include <zephyr/drivers/uart.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/device.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/sys/atomic.h>
+#include "chessboard_boot.h"
+#include "chessboard_detect.h"
 #include "watchdog.h"
 
 LOG_MODULE_REGISTER(app, LOG_LEVEL_INF);
 
+/* The loop below runs at least every 500 ms */
+#define MAIN_WDT_TIMEOUT_MS 1000
+/* Length of the blink on a change of a square */
+#define LED_EVENT_PULSE_MS  30
+
+#if defined(CONFIG_USB_DEVICE_STACK_NEXT)
 BUILD_ASSERT(DT_NODE_HAS_COMPAT(DT_CHOSEN(zephyr_console), zephyr_cdc_acm_uart),
 	     "Console device is not ACM CDC UART device");
+#endif
 
 static const struct gpio_dt_spec led = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
+/* State of the heartbeat, the LED returns to it after a blink */
+static atomic_t heartbeat_on = ATOMIC_INIT(1);
+
+static void led_restore(struct k_work *work)
+{
+	ARG_UNUSED(work);
+	gpio_pin_set_dt(&led, atomic_get(&heartbeat_on));
+}
+
+static K_WORK_DELAYABLE_DEFINE(led_restore_work, led_restore);
 
+/* Blink on every change of a square, the opposite of the heartbeat for a moment without
+ * shifting its phase. Runs in the scanner thread.
+ */
+static void led_square_event(const struct zbus_channel *chan)
+{
+	ARG_UNUSED(chan);
+	gpio_pin_set_dt(&led, !atomic_get(&heartbeat_on));
+	k_work_reschedule(&led_restore_work, K_MSEC(LED_EVENT_PULSE_MS));
+}
+
+ZBUS_LISTENER_DEFINE(led_listener, led_square_event);
+ZBUS_CHAN_ADD_OBS(chessboard_event_chan, led_listener, 3);
+
+static void heartbeat_toggle(void)
+{
+	const bool on = !atomic_get(&heartbeat_on);
+
+	atomic_set(&heartbeat_on, on);
+	gpio_pin_set_dt(&led, on);
+}
+
+/* Consoles without line control, e.g. on native_sim, are always connected */
+static uint32_t console_dtr(const struct device *dev)
+{
+	uint32_t dtr = 0;
+
+	if (uart_line_ctrl_get(dev, UART_LINE_CTRL_DTR, &dtr) != 0) {
+		return 1;
+	}
+	return dtr;
+}
 
 int main(void)
 {
@@ -24,29 +76,29 @@ int main(void)
 
 	gpio_pin_configure_dt(&led, GPIO_OUTPUT_ACTIVE);
 
-	bool led_state = false;
+	const int wdt_channel = watchdog_add_channel("main", MAIN_WDT_TIMEOUT_MS);
 
 dtr_not_set:
 
 	/* Poll if the DTR flag was set */
 	while (!dtr) {
-		feed_watchdog();
+		watchdog_feed(wdt_channel);
 
-		uart_line_ctrl_get(dev, UART_LINE_CTRL_DTR, &dtr);
+		dtr = console_dtr(dev);
 		/* Give CPU resources to low-priority threads. */
-		gpio_pin_set_dt(&led, (int)led_state);
-		led_state = !led_state;
+		heartbeat_toggle();
 		k_msleep(100);
 	}
 
+	chessboard_boot_mark(CHESSBOARD_BOOT_CONSOLE);
+
 	while (1) {
-		feed_watchdog();
+		watchdog_feed(wdt_channel);
 
-		gpio_pin_set_dt(&led, (int)led_state);
-		led_state = !led_state;
+		heartbeat_toggle();
 		k_msleep(500);
 
-		uart_line_ctrl_get(dev, UART_LINE_CTRL_DTR, &dtr);
+		dtr = console_dtr(dev);
 		if (!dtr) {
 			goto dtr_not_set;
 		}
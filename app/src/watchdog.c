@@ -1,56 +1,58 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/watchdog.h>
+#include <zephyr/task_wdt/task_wdt.h>
 
 #include <zephyr/logging/log.h>
-#include <zephyr/init.h>
+
+#include "watchdog.h"
 
 LOG_MODULE_REGISTER(watchdog_setup, LOG_LEVEL_INF);
 
 static const struct device *const wdt = DEVICE_DT_GET(DT_ALIAS(watchdog0));
 
-static int wdt_channel_id;
-
-static int setup_watchdog(void)
+int watchdog_init(void)
 {
-	int err;
+	const struct device *hw_wdt = wdt;
 
-	if (!device_is_ready(wdt)) {
+	if (!device_is_ready(hw_wdt)) {
+		/* The task watchdog still resets the SoC, just without a hardware fallback */
 		LOG_ERR("Watchdog device not ready.");
-		return -ENODEV;
-	}
-
-	struct wdt_timeout_cfg wdt_config = {
-		/* Reset SoC when watchdog timer expires. */
-		.flags = WDT_FLAG_RESET_SOC,
-
-		/* Expire watchdog after 1000 ms */
-		.window.min = 0,
-		.window.max = 1000,
-	};
-
-	wdt_channel_id = wdt_install_timeout(wdt, &wdt_config);
-	if (wdt_channel_id < 0) {
-		LOG_ERR("Watchdog install error: %d", wdt_channel_id);
-		return wdt_channel_id;
+		hw_wdt = NULL;
 	}
 
-	err = wdt_setup(wdt, 0);
+	int err = task_wdt_init(hw_wdt);
 	if (err < 0) {
-		LOG_ERR("Watchdog setup error: %d", err);
+		LOG_ERR("Task watchdog init error: %d", err);
 		return err;
 	}
 
-	LOG_INF("Watchdog initialized, channel id: %d", wdt_channel_id);
+	LOG_INF("Task watchdog initialized%s", (hw_wdt != NULL) ? " with hardware fallback" : "");
 	return 0;
-};
+}
+
+int watchdog_add_channel(const char *name, uint32_t timeout_ms)
+{
+	/* Without a callback an expired channel resets the SoC */
+	int channel = task_wdt_add(timeout_ms, NULL, NULL);
+
+	if (channel < 0) {
+		LOG_ERR("Watchdog channel for %s not installed: %d", name, channel);
+		return channel;
+	}
+
+	LOG_INF("Watchdog channel %d supervises %s, timeout %u ms", channel, name, timeout_ms);
+	return channel;
+}
 
-void feed_watchdog(void)
+void watchdog_feed(int channel)
 {
-	int err = wdt_feed(wdt, wdt_channel_id);
+	if (channel < 0) {
+		return;
+	}
+
+	int err = task_wdt_feed(channel);
 	if (err < 0) {
 		LOG_ERR("Watchdog feed error: %d", err);
 	}
 }
-
-SYS_INIT(setup_watchdog, POST_KERNEL, 0);
@@ -1,3 +1,34 @@
 #pragma once
 
-void feed_watchdog(void);
+#include <errno.h>
+#include <stdint.h>
+
+#if defined(CONFIG_TASK_WDT)
+/* Start the task watchdog, called once at boot */
+int watchdog_init(void);
+
+/**
+ * Supervise a thread: unless it calls watchdog_feed() with the returned channel at least every
+ * @p timeout_ms, the board resets.
+ *
+ * @return Channel id, or a negative error if no channel is left.
+ */
+int watchdog_add_channel(const char *name, uint32_t timeout_ms);
+
+/* Ignores negative channels, i.e. channels that could not be added */
+void watchdog_feed(int channel);
+#else
+static inline int watchdog_init(void)
+{
+	return 0;
+}
+
+static inline int watchdog_add_channel(const char *name, uint32_t timeout_ms)
+{
+	return -ENOTSUP;
+}
+
+static inline void watchdog_feed(int channel)
+{
+}
+#endif
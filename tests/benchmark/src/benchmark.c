@@ -0,0 +1,384 @@
+/*
+ * Scan throughput and detection latency on the emulated board. Every measurement is printed as
+ * "BENCH <metric>=<value>", twister records them in twister.json, see testcase.yaml and
+ * tools/chessboard_bench.py.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/zbus/zbus.h>
+
+#include "chessboard.h"
+#include "chessboard_calibration.h"
+#include "chessboard_detect.h"
+#include "chessboard_scanner.h"
+#include "chessboard_sim.h"
+
+#define BENCH_ITERATIONS         20
+#define BENCH_FPS_FRAMES         50
+/* Background scan period during the scan cost measurements, so they rarely wait for the scanner */
+#define BENCH_QUIET_PERIOD_MS    1000
+#define BENCH_LATENCY_TRIALS     10
+#define BENCH_LATENCY_TIMEOUT_MS 1000
+#define BENCH_LATENCY_SETTLE_MS  200
+#define BENCH_BUS_FRAMES         20
+/* Long enough for the frames at the idle sentinel period */
+#define BENCH_BUS_TIMEOUT_MS     5000
+/* Longer than the idle timeout of the scanner */
+#define BENCH_IDLE_WAIT_MS       40000
+/* Time a sentinel scan and its frame processing may take on top of the sentinel period */
+#define BENCH_WAKE_SLACK_MS      20
+/* Full boards the scanner acquires for the rate of each profile */
+#define BENCH_PROFILE_BOARDS     20
+
+/* The square every latency measurement toggles */
+#define BENCH_SQUARE CHESS_SQUARE(CHESS_FILE_D, CHESS_RANK_4)
+
+K_MSGQ_DEFINE(bench_event_queue, sizeof(struct chessboard_event), CHESSBOARD_DETECT_MAX_BURST,
+	      4);
+
+typedef int (*bench_fn)(unsigned long iteration);
+
+static void report(const char *metric, uint32_t value)
+{
+	TC_PRINT("BENCH %s=%u\n", metric, value);
+}
+
+static void report_cycles(const char *name, uint32_t cycles)
+{
+	char metric[32];
+
+	snprintk(metric, sizeof(metric), "%s_cycles", name);
+	report(metric, cycles);
+	snprintk(metric, sizeof(metric), "%s_us", name);
+	report(metric, k_cyc_to_us_floor32(cycles));
+}
+
+static int bench_full_scan(unsigned long iteration)
+{
+	return chessboard_scan();
+}
+
+static int bench_file_scan(unsigned long iteration)
+{
+	return chessboard_scan_file(iteration % CHESS_NUM_FILES);
+}
+
+/* The same square every time, so no channel setup or multiplexer switch */
+static int bench_read(unsigned long iteration)
+{
+	return chessboard_scan_squares(BIT64(CHESS_SQUARE(CHESS_FILE_E, CHESS_RANK_4)));
+}
+
+/* A different file every time, so a channel setup and multiplexer switch per read */
+static int bench_sparse_read(unsigned long iteration)
+{
+	return chessboard_scan_squares(BIT64((iteration * 9) % CHESS_NUM_SQUARES));
+}
+
+/* Average cycles per call of fn(), with the background scans slowed down */
+static uint32_t bench_run(bench_fn fn, unsigned long iterations)
+{
+	const uint32_t period_ms = chessboard_scanner_get_period();
+	uint64_t total = 0;
+
+	chessboard_scanner_set_period(BENCH_QUIET_PERIOD_MS);
+	for (unsigned long i = 0; i < iterations; i++) {
+		const uint32_t start = k_cycle_get_32();
+		int ret = fn(i);
+
+		total += k_cycle_get_32() - start;
+		zassert_ok(ret, "iteration %lu failed", i);
+	}
+	chessboard_scanner_set_period(period_ms);
+
+	return (uint32_t)(total / iterations);
+}
+
+/* Wait for @p square to turn @p state, returns the cycle counter at the event or 0 on timeout */
+static uint32_t wait_event(uint8_t square, uint8_t state, int64_t deadline)
+{
+	struct chessboard_event event;
+
+	while (k_msgq_get(&bench_event_queue, &event, K_TIMEOUT_ABS_MS(deadline)) == 0) {
+		if ((event.square == square) && (event.new_state == state)) {
+			return k_cycle_get_32();
+		}
+	}
+	return 0;
+}
+
+static bool square_occupied(void)
+{
+	return chessboard_detect_get_state(CHESS_FILE_D, CHESS_RANK_4) != CHESS_SQUARE_NEUTRAL;
+}
+
+ZTEST(benchmark, test_full_scan)
+{
+	const uint32_t cycles = bench_run(bench_full_scan, BENCH_ITERATIONS);
+
+	report_cycles("full_scan", cycles);
+}
+
+/* Frames per second of back to back full scans */
+ZTEST(benchmark, test_scan_fps)
+{
+	const uint32_t cycles = bench_run(bench_full_scan, BENCH_FPS_FRAMES);
+
+	report("scan_fps", (uint32_t)(sys_clock_hw_cycles_per_sec() / MAX(cycles, 1)));
+}
+
+/* Cost of one ADC read, with and without a channel setup */
+ZTEST(benchmark, test_read)
+{
+	report_cycles("read", bench_run(bench_read, BENCH_ITERATIONS * CHESS_NUM_SQUARES));
+	report_cycles("sparse_read",
+		      bench_run(bench_sparse_read, BENCH_ITERATIONS * CHESS_NUM_SQUARES));
+}
+
+/* A file is one channel setup and eight reads, eight of them should not cost more than a full
+ * scan
+ */
+ZTEST(benchmark, test_file_scan)
+{
+	const uint32_t file_cycles = bench_run(bench_file_scan, BENCH_ITERATIONS * CHESS_NUM_FILES);
+	const uint32_t full_cycles = bench_run(bench_full_scan, BENCH_ITERATIONS);
+
+	report_cycles("file_scan", file_cycles);
+	report("file_scan_share_pct",
+	       (uint32_t)((100ull * CHESS_NUM_FILES * file_cycles) / MAX(full_cycles, 1)));
+	zassert_true(file_cycles <= full_cycles, "a file scan costs more than a full scan");
+}
+
+/* Time from a change of the simulated board to the detection event. An even number of toggles
+ * leaves the square as it was.
+ */
+ZTEST(benchmark, test_change_latency)
+{
+	const bool occupied = square_occupied();
+	uint32_t min_us = UINT32_MAX;
+	uint32_t max_us = 0;
+	uint64_t total_us = 0;
+	uint32_t count = 0;
+
+	k_msgq_purge(&bench_event_queue);
+	zassert_ok(chessboard_detect_subscribe(&bench_event_queue));
+
+	for (int trial = 0; trial < BENCH_LATENCY_TRIALS; trial++) {
+		const bool place = ((trial & 1) == 0) != occupied;
+		const uint8_t expected = place ? CHESS_SQUARE_POSITIVE : CHESS_SQUARE_NEUTRAL;
+		const uint32_t start = k_cycle_get_32();
+
+		chessboard_sim_set_piece(BENCH_SQUARE,
+					 place ? CHESSBOARD_SIM_WHITE : CHESSBOARD_SIM_EMPTY);
+
+		const uint32_t end = wait_event(BENCH_SQUARE, expected,
+						k_uptime_get() + BENCH_LATENCY_TIMEOUT_MS);
+
+		if (end != 0) {
+			const uint32_t us = k_cyc_to_us_floor32(end - start);
+
+			min_us = MIN(min_us, us);
+			max_us = MAX(max_us, us);
+			total_us += us;
+			count++;
+		}
+		k_msleep(BENCH_LATENCY_SETTLE_MS);
+	}
+
+	chessboard_detect_unsubscribe(&bench_event_queue);
+
+	report("latency_trials", BENCH_LATENCY_TRIALS);
+	report("latency_timeouts", BENCH_LATENCY_TRIALS - count);
+	zassert_equal(count, BENCH_LATENCY_TRIALS, "%u changes were not detected",
+		      BENCH_LATENCY_TRIALS - count);
+	report("latency_min_us", min_us);
+	report("latency_avg_us", (uint32_t)(total_us / count));
+	report("latency_max_us", max_us);
+}
+
+/* Wait for the scanner to go idle, then set @p piece on the latency square and return the time to
+ * its @p expected event in ms, or 0 on timeout
+ */
+static uint32_t idle_wake_ms(uint8_t piece, uint8_t expected)
+{
+	struct chessboard_scanner_stats stats;
+	const int64_t idle_deadline = k_uptime_get() + BENCH_IDLE_WAIT_MS;
+
+	do {
+		k_msleep(CHESSBOARD_SCANNER_SENTINEL_PERIOD_MS);
+		chessboard_scanner_get_stats(&stats);
+	} while ((stats.mode != CHESSBOARD_SCANNER_MODE_IDLE) && (k_uptime_get() < idle_deadline));
+	zassert_equal(stats.mode, CHESSBOARD_SCANNER_MODE_IDLE, "scanner did not go idle");
+
+	/* Anywhere within the sentinel period */
+	k_msleep(CHESSBOARD_SCANNER_SENTINEL_PERIOD_MS / 3);
+	k_msgq_purge(&bench_event_queue);
+
+	const uint32_t start = k_cycle_get_32();
+
+	chessboard_sim_set_piece(BENCH_SQUARE, piece);
+
+	const uint32_t end = wait_event(BENCH_SQUARE, expected,
+					k_uptime_get() + BENCH_LATENCY_TIMEOUT_MS);
+
+	return (end != 0) ? k_cyc_to_ms_ceil32(end - start) : 0;
+}
+
+/* Time from an idle board being touched to the event, a lifted piece and a piece placed on an empty
+ * square have to be reported within one sentinel period
+ */
+ZTEST(benchmark, test_idle_wake_latency)
+{
+	struct chessboard_scanner_stats stats;
+
+	k_msgq_purge(&bench_event_queue);
+	zassert_ok(chessboard_detect_subscribe(&bench_event_queue));
+	if (!square_occupied()) {
+		chessboard_sim_set_piece(BENCH_SQUARE, CHESSBOARD_SIM_WHITE);
+		zassert_not_equal(wait_event(BENCH_SQUARE, CHESS_SQUARE_POSITIVE,
+					     k_uptime_get() + BENCH_LATENCY_TIMEOUT_MS),
+				  0, "piece not detected");
+	}
+
+	const uint32_t lift_ms = idle_wake_ms(CHESSBOARD_SIM_EMPTY, CHESS_SQUARE_NEUTRAL);
+
+	chessboard_scanner_get_stats(&stats);
+	report("wake_event_ms", lift_ms);
+	report("wake_latency_ms", stats.last_wake_latency_ms);
+
+	const uint32_t place_ms = idle_wake_ms(CHESSBOARD_SIM_WHITE, CHESS_SQUARE_POSITIVE);
+
+	chessboard_detect_unsubscribe(&bench_event_queue);
+	report("wake_place_event_ms", place_ms);
+
+	zassert_not_equal(lift_ms, 0, "lifted piece not detected");
+	zassert_true(lift_ms <= CHESSBOARD_SCANNER_SENTINEL_PERIOD_MS + BENCH_WAKE_SLACK_MS,
+		     "woke up after %u ms", lift_ms);
+	zassert_not_equal(place_ms, 0, "placed piece not detected");
+	zassert_true(place_ms <= CHESSBOARD_SCANNER_SENTINEL_PERIOD_MS + BENCH_WAKE_SLACK_MS,
+		     "woke up after %u ms for a placed piece", place_ms);
+}
+
+/* Only written by the listener, which stops once all frames are measured */
+static struct {
+	uint32_t min_cycles;
+	uint32_t max_cycles;
+	uint64_t total_cycles;
+	uint32_t count;
+} bench_bus;
+static K_SEM_DEFINE(bench_bus_done, 0, 1);
+
+/* Runs in the scanner thread for every published frame while enabled */
+static void bench_bus_observe(const struct zbus_channel *chan)
+{
+	const struct chessboard_frame *frame = zbus_chan_const_msg(chan);
+	const uint32_t cycles = k_cycle_get_32() - frame->ready_cycles;
+
+	if (bench_bus.count >= BENCH_BUS_FRAMES) {
+		return;
+	}
+
+	bench_bus.min_cycles = MIN(bench_bus.min_cycles, cycles);
+	bench_bus.max_cycles = MAX(bench_bus.max_cycles, cycles);
+	bench_bus.total_cycles += cycles;
+	if (++bench_bus.count == BENCH_BUS_FRAMES) {
+		k_sem_give(&bench_bus_done);
+	}
+}
+
+ZBUS_LISTENER_DEFINE_WITH_ENABLE(bench_bus_listener, bench_bus_observe, false);
+ZBUS_CHAN_ADD_OBS(chessboard_frame_chan, bench_bus_listener, 3);
+
+/* Time from a frame being complete to a listener of chessboard_frame_chan reading it in place */
+ZTEST(benchmark, test_bus_latency)
+{
+	bench_bus.min_cycles = UINT32_MAX;
+	bench_bus.max_cycles = 0;
+	bench_bus.total_cycles = 0;
+	bench_bus.count = 0;
+	k_sem_reset(&bench_bus_done);
+
+	zbus_obs_set_enable(&bench_bus_listener, true);
+	int ret = k_sem_take(&bench_bus_done, K_MSEC(BENCH_BUS_TIMEOUT_MS));
+	zbus_obs_set_enable(&bench_bus_listener, false);
+
+	zassert_ok(ret, "no frames on the bus");
+
+	const uint32_t avg_cycles = (uint32_t)(bench_bus.total_cycles / bench_bus.count);
+
+	report("bus_frames", bench_bus.count);
+	report("bus_min_cycles", bench_bus.min_cycles);
+	report_cycles("bus_avg", avg_cycles);
+	report_cycles("bus_max", bench_bus.max_cycles);
+}
+
+/* Full board scans per second of the scanner thread with @p profile, from the squares acquired
+ * by its frames between the first and the last one
+ */
+static uint32_t profile_fps(uint8_t profile)
+{
+	struct chessboard_frame frame;
+	uint64_t squares = 0;
+
+	zassert_ok(chessboard_scanner_set_profile(profile));
+	chessboard_scanner_wake();
+	zassert_ok(chessboard_wait_frame(&frame, 0, K_SECONDS(1)), "no frame from the scanner");
+	/* The frame in progress may still use the previous profile */
+	zassert_ok(chessboard_wait_frame(&frame, frame.seq, K_SECONDS(1)),
+		   "no frame from the scanner");
+
+	const uint32_t start = frame.ready_cycles;
+
+	while (squares < (uint64_t)BENCH_PROFILE_BOARDS * CHESS_NUM_SQUARES) {
+		zassert_ok(chessboard_wait_frame(&frame, frame.seq, K_SECONDS(1)),
+			   "no frame from the scanner");
+		squares += (uint64_t)__builtin_popcountll(frame.scanned);
+	}
+
+	const uint64_t cycles = MAX(frame.ready_cycles - start, 1);
+
+	return (uint32_t)((squares * sys_clock_hw_cycles_per_sec()) /
+			  (cycles * CHESS_NUM_SQUARES));
+}
+
+/* Full board rate of each profile. The emulated ADC converts as fast with either setting, so the
+ * rates are recorded for comparison across runs rather than checked against each other.
+ */
+ZTEST(benchmark, test_profile_fps)
+{
+	const uint32_t precise_fps = profile_fps(CHESSBOARD_SCANNER_PROFILE_PRECISE);
+	const uint32_t fast_fps = profile_fps(CHESSBOARD_SCANNER_PROFILE_FAST);
+	const uint32_t confirm_fps = profile_fps(CHESSBOARD_SCANNER_PROFILE_CONFIRM);
+
+	zassert_ok(chessboard_scanner_set_profile(CHESSBOARD_SCANNER_PROFILE_PRECISE));
+	report("profile_precise_fps", precise_fps);
+	report("profile_fast_fps", fast_fps);
+	report("profile_confirm_fps", confirm_fps);
+}
+
+static void *benchmark_setup(void)
+{
+	struct chessboard_frame frame;
+
+	report("cycles_per_second", sys_clock_hw_cycles_per_sec());
+
+	/* The scanner is running once the first frame is out */
+	zassert_ok(chessboard_wait_frame(&frame, 0, K_SECONDS(1)), "no frame from the scanner");
+	chessboard_sim_exec(1, (char *[]){"clear"});
+	zassert_ok(chessboard_calibration_calibrate(CHESSBOARD_CALIBRATION_DEFAULT_FRAMES),
+		   "calibration failed");
+	return NULL;
+}
+
+/* Every measurement starts in active mode, an idle scanner publishes no frames of an empty board */
+static void benchmark_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+	chessboard_scanner_wake();
+	k_msleep(CHESSBOARD_SCANNER_SENTINEL_PERIOD_MS);
+}
+
+ZTEST_SUITE(benchmark, NULL, benchmark_setup, benchmark_before, NULL, NULL);
@@ -0,0 +1,158 @@
+/*
+ * Noise statistics of the calibration, the running moments and the integer square root, and the
+ * tolerance before a file is stored again.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+
+/* The statistics are internal to the calibration, so its source is built here */
+#include "chessboard_calibration.c"
+
+static uint16_t noise_q8_of(const int32_t samples[], int32_t n)
+{
+	struct square_moments m = {0};
+	int16_t offset_raw;
+	uint16_t noise_q8;
+
+	for (int32_t i = 0; i < n; i++) {
+		moments_add(&m, i + 1, samples[i]);
+	}
+	zassert_true(m.m2_q16 >= 0);
+	moments_result(&m, n, &offset_raw, &noise_q8);
+	return noise_q8;
+}
+
+ZTEST(calibration, test_isqrt64)
+{
+	zassert_equal(isqrt64(0), 0);
+	zassert_equal(isqrt64(1), 1);
+	zassert_equal(isqrt64(3), 1);
+	zassert_equal(isqrt64(4), 2);
+	zassert_equal(isqrt64(2621440), 1619);
+	zassert_equal(isqrt64(65535ull * 65535ull), 65535);
+	zassert_equal(isqrt64(65536ull * 65536ull - 1), 65535);
+	zassert_equal(isqrt64(UINT64_MAX), UINT32_MAX);
+}
+
+ZTEST(calibration, test_moments)
+{
+	const int32_t samples[] = {2040, 2044, 2048, 2052, 2056};
+	struct square_moments m = {0};
+
+	for (int32_t i = 0; i < ARRAY_SIZE(samples); i++) {
+		moments_add(&m, i + 1, samples[i]);
+	}
+
+	/* Mean 2048, squared deviations 64 + 16 + 0 + 16 + 64, in 1/256 and 1/65536 counts */
+	zassert_equal(m.mean_q8, 2048 * 256);
+	zassert_equal(m.m2_q16, 160ll * 65536);
+	/* Sample standard deviation sqrt(160 / 4) = 6.32 counts */
+	zassert_equal(noise_q8_of(samples, ARRAY_SIZE(samples)), 1619);
+}
+
+ZTEST(calibration, test_constant_has_no_noise)
+{
+	const int32_t samples[] = {-300, -300, -300, -300};
+
+	zassert_equal(noise_q8_of(samples, ARRAY_SIZE(samples)), 0);
+}
+
+ZTEST(calibration, test_long_series)
+{
+	static int32_t samples[1000];
+
+	/* 2000 and 2010 alternating, a standard deviation of 5 counts, without the rounding of
+	 * the running mean adding up
+	 */
+	for (int32_t i = 0; i < ARRAY_SIZE(samples); i++) {
+		samples[i] = 2000 + ((i & 1) * 10);
+	}
+	zassert_equal(noise_q8_of(samples, ARRAY_SIZE(samples)), 5 * 256);
+}
+
+ZTEST(calibration, test_change_tolerance)
+{
+	/* Noise of 2000 in 1/256 counts, 7.8 counts, over 32 frames: three standard errors are 5.9
+	 * counts of offset and 1078 of noise, against the larger noise of the two
+	 */
+	zassert_false(square_changed(2048, 2000, 2048, 2000, 32));
+	zassert_false(square_changed(2048, 2000, 2047, 2100, 32));
+	zassert_false(square_changed(-10, 2000, -9, 1900, 32));
+	zassert_false(square_changed(2048, 2000, 2053, 2000, 32));
+	zassert_true(square_changed(2048, 2000, 2054, 2000, 32));
+	zassert_true(square_changed(2048, 2000, 2042, 2000, 32));
+	zassert_false(square_changed(2048, 2000, 2048, 1000, 32));
+	zassert_true(square_changed(2048, 2000, 2048, 900, 32));
+	zassert_false(square_changed(2048, 2000, 2048, 4300, 32));
+	zassert_true(square_changed(2048, 2000, 2048, 4400, 32));
+	/* More frames, smaller errors */
+	zassert_false(square_changed(2048, 2000, 2048, 2600, 32));
+	zassert_true(square_changed(2048, 2000, 2048, 2600, 256));
+	zassert_true(square_changed(2048, 2000, 2053, 2000, 256));
+	/* Any noise is a change from none, a quiet square keeps a count of offset tolerance */
+	zassert_true(square_changed(2048, 0, 2048, 1, 32));
+	zassert_false(square_changed(2048, 0, 2049, 0, 32));
+	zassert_true(square_changed(2048, 0, 2050, 0, 32));
+}
+
+static uint32_t noise_state;
+
+/* About normal around 2048 with a standard deviation of 9.2 counts, the sum of four uniform draws
+ * of a linear congruential generator
+ */
+static int32_t noise_sample(void)
+{
+	int32_t sum = 0;
+
+	for (int i = 0; i < 4; i++) {
+		noise_state = noise_state * 1103515245u + 12345u;
+		sum += (noise_state >> 16) % 16;
+	}
+	return 2048 - 30 + sum;
+}
+
+static void calibrate_square(int32_t frames, int16_t *offset_raw, uint16_t *noise_q8)
+{
+	struct square_moments m = {0};
+
+	for (int32_t i = 0; i < frames; i++) {
+		moments_add(&m, i + 1, noise_sample());
+	}
+	moments_result(&m, frames, offset_raw, noise_q8);
+}
+
+/* Calibrating an unchanged board twice does not store a file again, the two estimates of every
+ * square differ by no more than their sampling error
+ */
+ZTEST(calibration, test_same_noise_unchanged)
+{
+	const int32_t frames = CHESSBOARD_CALIBRATION_DEFAULT_FRAMES;
+
+	noise_state = 1;
+	for (uint8_t rank = 0; rank < CHESS_NUM_RANKS; rank++) {
+		int16_t offset_raw;
+		int16_t new_offset_raw;
+		uint16_t noise_q8;
+		uint16_t new_noise_q8;
+
+		calibrate_square(frames, &offset_raw, &noise_q8);
+		calibrate_square(frames, &new_offset_raw, &new_noise_q8);
+		zassert_false(square_changed(offset_raw, noise_q8, new_offset_raw, new_noise_q8,
+					     frames),
+			      "rank %u: %d/%u then %d/%u", rank, offset_raw, noise_q8,
+			      new_offset_raw, new_noise_q8);
+	}
+}
+
+ZTEST(calibration, test_confirm_margin)
+{
+	/* Four standard deviations rounded up, never below one count */
+	zassert_equal(confirm_margin(0), 1);
+	zassert_equal(confirm_margin(256), 4);
+	zassert_equal(confirm_margin(257), 5);
+	zassert_equal(confirm_margin(5 * 256 + 128), 22);
+}
+
+ZTEST_SUITE(calibration, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,120 @@
+/*
+ * Classification of the square offsets with hysteresis, all squares at once on bitboards.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+
+/* classify() is internal to the detection, so its source is built here */
+#include "chessboard_detect.c"
+
+#define TEST_NEGATIVE   -100
+#define TEST_POSITIVE   100
+#define TEST_HYSTERESIS 20
+
+#define E2 CHESS_SQUARE(CHESS_FILE_E, CHESS_RANK_2)
+
+static struct chessboard_thresholds test_thresholds[CHESS_NUM_SQUARES];
+static int16_t test_offsets[CHESS_NUM_SQUARES];
+
+static void *detect_setup(void)
+{
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		test_thresholds[square] = (struct chessboard_thresholds){
+			.negative_raw = TEST_NEGATIVE,
+			.positive_raw = TEST_POSITIVE,
+			.hysteresis_raw = TEST_HYSTERESIS,
+		};
+	}
+	return NULL;
+}
+
+static void detect_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+	memset(test_offsets, 0, sizeof(test_offsets));
+}
+
+/* State of E2 in the next frame when it was in @p state, with an offset of @p offset */
+static uint8_t next_state(uint8_t state, int16_t offset)
+{
+	const struct chessboard_bitboards previous = {
+		.positive = (state == CHESS_SQUARE_POSITIVE) ? BIT64(E2) : 0,
+		.negative = (state == CHESS_SQUARE_NEGATIVE) ? BIT64(E2) : 0,
+	};
+	const uint64_t known = (state == CHESS_SQUARE_UNKNOWN) ? 0 : UINT64_MAX;
+
+	test_offsets[E2] = offset;
+
+	const struct chessboard_bitboards next =
+		classify(test_offsets, test_thresholds, &previous, known);
+
+	return square_state(next.positive, next.negative, UINT64_MAX, E2);
+}
+
+ZTEST(detect, test_unknown_uses_plain_thresholds)
+{
+	zassert_equal(next_state(CHESS_SQUARE_UNKNOWN, TEST_POSITIVE + 1), CHESS_SQUARE_POSITIVE);
+	zassert_equal(next_state(CHESS_SQUARE_UNKNOWN, TEST_POSITIVE), CHESS_SQUARE_NEUTRAL);
+	zassert_equal(next_state(CHESS_SQUARE_UNKNOWN, TEST_NEGATIVE - 1), CHESS_SQUARE_NEGATIVE);
+	zassert_equal(next_state(CHESS_SQUARE_UNKNOWN, TEST_NEGATIVE), CHESS_SQUARE_NEUTRAL);
+}
+
+ZTEST(detect, test_neutral_needs_outer_bound)
+{
+	const int16_t high = TEST_POSITIVE + TEST_HYSTERESIS;
+	const int16_t low = TEST_NEGATIVE - TEST_HYSTERESIS;
+
+	zassert_equal(next_state(CHESS_SQUARE_NEUTRAL, high), CHESS_SQUARE_NEUTRAL);
+	zassert_equal(next_state(CHESS_SQUARE_NEUTRAL, high + 1), CHESS_SQUARE_POSITIVE);
+	zassert_equal(next_state(CHESS_SQUARE_NEUTRAL, low), CHESS_SQUARE_NEUTRAL);
+	zassert_equal(next_state(CHESS_SQUARE_NEUTRAL, low - 1), CHESS_SQUARE_NEGATIVE);
+}
+
+ZTEST(detect, test_positive_holds_down_to_inner_bound)
+{
+	const int16_t inner = TEST_POSITIVE - TEST_HYSTERESIS;
+
+	zassert_equal(next_state(CHESS_SQUARE_POSITIVE, inner + 1), CHESS_SQUARE_POSITIVE);
+	zassert_equal(next_state(CHESS_SQUARE_POSITIVE, inner), CHESS_SQUARE_NEUTRAL);
+	/* Straight to the other state, as when a piece is swapped between two frames */
+	zassert_equal(next_state(CHESS_SQUARE_POSITIVE, TEST_NEGATIVE - TEST_HYSTERESIS - 1),
+		      CHESS_SQUARE_NEGATIVE);
+}
+
+ZTEST(detect, test_negative_holds_up_to_inner_bound)
+{
+	const int16_t inner = TEST_NEGATIVE + TEST_HYSTERESIS;
+
+	zassert_equal(next_state(CHESS_SQUARE_NEGATIVE, inner - 1), CHESS_SQUARE_NEGATIVE);
+	zassert_equal(next_state(CHESS_SQUARE_NEGATIVE, inner), CHESS_SQUARE_NEUTRAL);
+	zassert_equal(next_state(CHESS_SQUARE_NEGATIVE, TEST_POSITIVE + TEST_HYSTERESIS + 1),
+		      CHESS_SQUARE_POSITIVE);
+}
+
+ZTEST(detect, test_changed_mask)
+{
+	/* Every square positive in the previous frame, two of them leave it */
+	const struct chessboard_bitboards previous = {.positive = UINT64_MAX};
+	const uint8_t a1 = CHESS_SQUARE(CHESS_FILE_A, CHESS_RANK_1);
+	const uint8_t h8 = CHESS_SQUARE(CHESS_FILE_H, CHESS_RANK_8);
+	struct chessboard_bitboards next;
+
+	for (uint8_t square = 0; square < CHESS_NUM_SQUARES; square++) {
+		test_offsets[square] = TEST_POSITIVE;
+	}
+	test_offsets[a1] = 0;
+	test_offsets[h8] = TEST_NEGATIVE - TEST_HYSTERESIS - 1;
+
+	next = classify(test_offsets, test_thresholds, &previous, UINT64_MAX);
+	zassert_equal(next.positive, UINT64_MAX & ~BIT64(a1) & ~BIT64(h8));
+	zassert_equal(next.negative, BIT64(h8));
+	zassert_equal(next.changed, BIT64(a1) | BIT64(h8));
+
+	/* Unknown squares are reported as changed whatever their state */
+	next = classify(test_offsets, test_thresholds, &previous, ~BIT64(E2));
+	zassert_equal(next.changed, BIT64(a1) | BIT64(h8) | BIT64(E2));
+}
+
+ZTEST_SUITE(detect, NULL, detect_setup, detect_before, NULL, NULL);
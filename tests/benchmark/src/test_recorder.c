@@ -0,0 +1,91 @@
+/*
+ * Variable length integers of the recording, see the record layout in chessboard_recorder.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+
+/* The codec is internal to the recorder, so its source is built here */
+#include "chessboard_recorder.c"
+
+/* Longest varint, 64 bits in groups of 7 */
+#define VARINT_MAX_SIZE 10
+
+static uint8_t encoded[2 * VARINT_MAX_SIZE];
+
+ZTEST(recorder, test_varint_round_trip)
+{
+	static const uint64_t values[] = {
+		0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, UINT32_MAX, 1ull << 63, UINT64_MAX,
+	};
+	static const uint8_t lengths[] = {1, 1, 1, 2, 2, 3, 5, 10, 10};
+
+	for (int i = 0; i < ARRAY_SIZE(values); i++) {
+		const uint8_t *end = put_varint(encoded, values[i]);
+		const uint8_t *p = encoded;
+		uint64_t value;
+
+		zassert_equal(end - encoded, lengths[i], "length of %llx", values[i]);
+		zassert_ok(get_varint(&p, end, &value));
+		zassert_equal(value, values[i]);
+		zassert_equal_ptr(p, end);
+	}
+}
+
+ZTEST(recorder, test_zigzag_round_trip)
+{
+	static const int32_t values[] = {0, -1, 1, -64, 63, -65, 64, INT32_MIN, INT32_MAX};
+	static const uint8_t lengths[] = {1, 1, 1, 1, 1, 2, 2, 5, 5};
+
+	for (int i = 0; i < ARRAY_SIZE(values); i++) {
+		const uint8_t *end = put_zigzag(encoded, values[i]);
+		const uint8_t *p = encoded;
+		int32_t value;
+
+		zassert_equal(end - encoded, lengths[i], "length of %d", values[i]);
+		zassert_ok(get_zigzag(&p, end, &value));
+		zassert_equal(value, values[i]);
+	}
+}
+
+ZTEST(recorder, test_consecutive_values)
+{
+	uint8_t *end = put_varint(encoded, 300);
+	const uint8_t *p = encoded;
+	uint64_t first;
+	int32_t second;
+
+	end = put_zigzag(end, -2);
+	zassert_ok(get_varint(&p, end, &first));
+	zassert_ok(get_zigzag(&p, end, &second));
+	zassert_equal(first, 300);
+	zassert_equal(second, -2);
+	zassert_equal_ptr(p, end);
+}
+
+ZTEST(recorder, test_truncated)
+{
+	const uint8_t *end = put_varint(encoded, 0x4000);
+	const uint8_t *p = encoded;
+	uint64_t value;
+
+	/* The last byte of three is missing */
+	zassert_equal(get_varint(&p, end - 1, &value), -EBADMSG);
+
+	p = encoded;
+	zassert_equal(get_varint(&p, encoded, &value), -EBADMSG);
+}
+
+ZTEST(recorder, test_overlong)
+{
+	const uint8_t *p = encoded;
+	uint64_t value;
+
+	/* More than 64 bits of continuation bytes */
+	memset(encoded, 0x80, sizeof(encoded));
+	zassert_equal(get_varint(&p, encoded + sizeof(encoded), &value), -EBADMSG);
+	zassert_equal_ptr(p, encoded + VARINT_MAX_SIZE);
+}
+
+ZTEST_SUITE(recorder, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,108 @@
+/*
+ * Text rendering of frames, events and moves, see chessboard_render.h.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#include "chessboard_render.h"
+
+static char buf[CHESSBOARD_RENDER_BOARD_SIZE];
+
+static void assert_rendered(int len, const char *expected)
+{
+	zassert_equal(len, strlen(expected), "%s", buf);
+	zassert_mem_equal(buf, expected, len + 1, "%s", buf);
+}
+
+/* Square index, negated on odd files, with two extremes to check the widths */
+static int32_t test_value(const struct chessboard_frame *frame, uint8_t file, uint8_t rank)
+{
+	if (file == 7 && rank == 7) {
+		return INT32_MIN;
+	}
+	if (file == 6 && rank == 7) {
+		return 123456;
+	}
+	return (file & 1) ? -(int32_t)CHESS_SQUARE(file, rank) : CHESS_SQUARE(file, rank);
+}
+
+ZTEST(render, test_board)
+{
+	const int len = chessboard_render_board(buf, sizeof(buf), NULL, test_value);
+
+	zassert_equal(len, strlen(buf));
+	/* Rank 8 first, values right aligned in four columns unless longer */
+	zassert_equal(strncmp(buf, "8|  56| -57|  58| -59|  60| -61|123456|-2147483648\n", 51), 0);
+	zassert_not_null(strstr(buf, "\n1|   0|  -1|   2|  -3|   4|  -5|   6|  -7\n\n"));
+	zassert_equal(buf[len - 1], '\n');
+}
+
+ZTEST(render, test_files)
+{
+	const int len = chessboard_render_files(buf, sizeof(buf), NULL, test_value);
+
+	zassert_equal(len, strlen(buf));
+	zassert_not_null(strstr(buf, "A|   0|   8|  16|  24|  32|  40|  48|  56\n"));
+	zassert_not_null(strstr(buf, "B|  -1|  -9| -17| -25| -33| -41| -49| -57\n"));
+	zassert_not_null(strstr(buf, "H|  -7| -15| -23| -31| -39| -47| -55|-2147483648\n"));
+}
+
+ZTEST(render, test_buffer_too_small)
+{
+	zassert_equal(chessboard_render_board(buf, sizeof(buf) - 1, NULL, test_value), -ENOSPC);
+	zassert_equal(chessboard_render_files(buf, sizeof(buf) - 1, NULL, test_value), -ENOSPC);
+}
+
+ZTEST(render, test_event)
+{
+	const struct chessboard_event event = {
+		.square = CHESS_SQUARE(CHESS_FILE_E, CHESS_RANK_2),
+		.old_state = CHESS_SQUARE_NEUTRAL,
+		.new_state = CHESS_SQUARE_POSITIVE,
+	};
+
+	assert_rendered(chessboard_render_event(buf, sizeof(buf), &event), "+E2\n");
+}
+
+ZTEST(render, test_move)
+{
+	struct chessboard_move move = {
+		.ply = 0,
+		.from = CHESS_SQUARE(CHESS_FILE_E, CHESS_RANK_2),
+		.to = CHESS_SQUARE(CHESS_FILE_E, CHESS_RANK_4),
+		.piece = CHESS_PIECE_PAWN,
+	};
+
+	assert_rendered(chessboard_render_move(buf, sizeof(buf), &move), "1. e2e4\n");
+
+	move = (struct chessboard_move){
+		.ply = 23,
+		.from = CHESS_SQUARE(CHESS_FILE_E, CHESS_RANK_2),
+		.to = CHESS_SQUARE(CHESS_FILE_E, CHESS_RANK_1),
+		.piece = CHESS_PIECE_PAWN | CHESS_PIECE_BLACK,
+		.promotion = CHESS_PIECE_QUEEN | CHESS_PIECE_BLACK,
+		.flags = CHESS_MOVE_PROMOTION | CHESS_MOVE_CHECK,
+	};
+	assert_rendered(chessboard_render_move(buf, sizeof(buf), &move), "12... e2e1q+\n");
+
+	move = (struct chessboard_move){
+		.ply = 4,
+		.from = CHESS_MOVE_NO_SQUARE,
+		.to = CHESS_MOVE_NO_SQUARE,
+		.flags = CHESS_MOVE_ILLEGAL,
+	};
+	assert_rendered(chessboard_render_move(buf, sizeof(buf), &move), "3. illegal position\n");
+}
+
+ZTEST(render, test_piece)
+{
+	zassert_equal(chessboard_render_piece(CHESS_PIECE_KNIGHT), 'N');
+	zassert_equal(chessboard_render_piece(CHESS_PIECE_KING | CHESS_PIECE_BLACK), 'k');
+	zassert_equal(chessboard_render_piece(CHESS_PIECE_NONE), '.');
+}
+
+ZTEST_SUITE(render, NULL, NULL, NULL, NULL, NULL);
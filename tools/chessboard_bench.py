@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Collect the benchmark suite results and compare them against a baseline.
+
+Reads the "BENCH <metric>=<value>" lines of tests/benchmark, either from the recording twister
+writes to twister.json or from a console log of the test, and prints the result. With --baseline
+every timing is compared with the baseline result and the script fails if any of them got slower
+by more than the tolerance.
+
+    west twister -T tests/benchmark -p native_sim
+    chessboard_bench.py twister-out/twister.json --output sim.json
+    chessboard_bench.py twister-out/twister.json --baseline sim.json --tolerance 10
+    chessboard_bench.py handler.log --baseline xiao.json
+"""
+
+import argparse
+import json
+import re
+import sys
+
+SUITE = "chessboard.benchmark"
+
+# Same pattern as the record regex in tests/benchmark/testcase.yaml
+BENCH_LINE = re.compile(r"BENCH (?P<metric>[a-z0-9_]+)=(?P<value>[0-9]+)")
+
+# Timings where lower is better
+TIMINGS = (
+    "full_scan_us",
+    "file_scan_us",
+    "read_us",
+    "sparse_read_us",
+    "latency_avg_us",
+    "latency_max_us",
+    "bus_avg_us",
+    "bus_max_us",
+)
+
+
+def from_twister(report):
+    """Results of the benchmark suite in a twister.json, or None if it did not run."""
+    for suite in report.get("testsuites", []):
+        if not suite.get("name", "").endswith(SUITE) or "recording" not in suite:
+            continue
+        result = {"board": suite.get("platform")}
+        for record in suite["recording"]:
+            result[record["metric"]] = int(record["value"])
+        return result
+    return None
+
+
+def from_log(lines):
+    """Results of the benchmark in a console log, or None if there are none."""
+    result = {}
+    for line in lines:
+        match = BENCH_LINE.search(line)
+        if match:
+            result[match["metric"]] = int(match["value"])
+    return result or None
+
+
+def compare(result, baseline, tolerance):
+    """Print the change of every timing, returns the names of the regressed ones."""
+    regressions = []
+    for name in TIMINGS:
+        if name not in result or name not in baseline or baseline[name] == 0:
+            continue
+        change = 100.0 * (result[name] - baseline[name]) / baseline[name]
+        regressed = change > tolerance
+        print("%-16s %10d us %10d us %+7.1f%%%s" % (
+            name, baseline[name], result[name], change, "  REGRESSION" if regressed else ""))
+        if regressed:
+            regressions.append(name)
+
+    if result.get("latency_timeouts"):
+        print("latency_timeouts %d" % result["latency_timeouts"])
+        regressions.append("latency_timeouts")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="twister.json, or a console log of the benchmark suite")
+    parser.add_argument("--output", help="write the result to this JSON file")
+    parser.add_argument("--baseline", help="JSON result to compare against")
+    parser.add_argument("--tolerance", type=float, default=5,
+                        help="allowed slow down in percent before failing")
+    args = parser.parse_args()
+
+    with open(args.input, errors="replace") as f:
+        if args.input.endswith(".json"):
+            result = from_twister(json.load(f))
+        else:
+            result = from_log(f)
+
+    if result is None:
+        print("no benchmark result found", file=sys.stderr)
+        return 2
+
+    print(json.dumps(result, indent=2))
+    if args.output:
+        with open(args.output, "w") as out:
+            json.dump(result, out, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get("board") != result.get("board"):
+            print("warning: comparing %s against a %s baseline" % (
+                result.get("board"), baseline.get("board")), file=sys.stderr)
+        if compare(result, baseline, args.tolerance):
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+"""Decode the binary frame stream of 'board stream full' and 'board stream delta'.
+
+Reads COBS framed packets from a serial port (requires pyserial) or from a capture file, keeps
+the board state up to date from keyframes and delta packets and prints every update. The chunks
+of 'board recorder dump binary' are put together and the recording is printed once complete.
+
+    chessboard_stream.py /dev/ttyACM0 --start "board stream delta offset 50 5"
+    chessboard_stream.py /dev/ttyACM0 --start "board recorder dump binary"
+    chessboard_stream.py capture.bin
+"""
+
+import argparse
+import collections
+import struct
+import sys
+
+TYPE_FRAME = 0x01
+TYPE_DELTA = 0x02
+TYPE_RECORDING = 0x03
+
+# Millivolts, sent by firmware before the values became raw ADC counts
+PAYLOAD_MV = 0
+PAYLOAD_MV_OFFSET = 1
+PAYLOAD_RAW = 2
+PAYLOAD_OFFSET = 3
+PAYLOADS = {
+    PAYLOAD_MV: "mV",
+    PAYLOAD_MV_OFFSET: "mV offset",
+    PAYLOAD_RAW: "raw counts",
+    PAYLOAD_OFFSET: "offset counts",
+}
+
+NUM_SQUARES = 64
+
+# Record layout of chessboard_recorder.h
+RECORDER_FORMAT = 2
+RECORD_KEYFRAME = 1
+RECORD_DELTA = 2
+RECORD_MOVE = 3
+
+PIECES = ".pnbrqk"
+PIECE_TYPE_MASK = 0x07
+PIECE_BLACK = 0x08
+MOVE_PROMOTION = 0x08
+MOVE_CHECK = 0x10
+MOVE_ILLEGAL = 0x40
+MOVE_AMBIGUOUS = 0x80
+
+# A keyframe or delta record, values holds all squares after the record was applied
+Frame = collections.namedtuple("Frame", "timestamp_ms seq keyframe changed values")
+Move = collections.namedtuple("Move", "timestamp_ms ply square_from square_to piece captured "
+                                      "promotion flags")
+
+
+def crc16_ccitt(data, seed=0xFFFF):
+    """Same algorithm as Zephyr's crc16_ccitt()."""
+    crc = seed
+    for byte in data:
+        e = (crc ^ byte) & 0xFF
+        f = (e ^ (e << 4)) & 0xFF
+        crc = (crc >> 8) ^ (f << 8) ^ (f << 3) ^ (f >> 4)
+        crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("invalid COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def get_varint(data, pos):
+    """Little endian base 128 value at pos, returns it and the position after it."""
+    value = 0
+    for shift in range(0, 64, 7):
+        if pos >= len(data):
+            raise ValueError("truncated varint")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+    raise ValueError("varint longer than 64 bits")
+
+
+def get_zigzag(data, pos):
+    raw, pos = get_varint(data, pos)
+    raw &= 0xFFFFFFFF
+    return (raw >> 1) ^ -(raw & 1), pos
+
+
+def decode_records(data):
+    """Frames and moves of a recording, the same way chessboard_recorder_next() decodes them.
+
+    Records before the first keyframe are skipped, their values and times are unknown.
+    """
+    records = []
+    values = None
+    timestamp_ms = 0
+    seq = 0
+    pos = 0
+    while pos < len(data):
+        length = data[pos]
+        body = data[pos + 1:pos + 1 + length]
+        pos += 1 + length
+        if length == 0 or len(body) != length:
+            raise ValueError("truncated record")
+
+        tag = body[0]
+        if tag == RECORD_MOVE:
+            dt_ms, p = get_varint(body, 1)
+            ply, p = get_varint(body, p)
+            if len(body) - p != 6:
+                raise ValueError("invalid move record")
+            timestamp_ms = (timestamp_ms + dt_ms) & 0xFFFFFFFF
+            if values is not None:
+                records.append(Move(timestamp_ms, ply, *body[p:]))
+            continue
+        if tag not in (RECORD_KEYFRAME, RECORD_DELTA):
+            raise ValueError("unknown record tag %d" % tag)
+
+        time, p = get_varint(body, 1)
+        dseq, p = get_varint(body, p)
+        mask = (1 << NUM_SQUARES) - 1
+        if tag == RECORD_DELTA:
+            mask, p = get_varint(body, p)
+        squares = [sq for sq in range(NUM_SQUARES) if mask & (1 << sq)]
+        decoded = []
+        for _ in squares:
+            value, p = get_zigzag(body, p)
+            decoded.append(value)
+        if p != len(body):
+            raise ValueError("invalid frame record")
+
+        if tag == RECORD_KEYFRAME:
+            values = decoded
+            timestamp_ms = time
+            seq = dseq
+        elif values is None:
+            continue
+        else:
+            values = list(values)
+            for sq, delta in zip(squares, decoded):
+                values[sq] += delta
+            timestamp_ms = (timestamp_ms + time) & 0xFFFFFFFF
+            seq = (seq + dseq) & 0xFFFFFFFF
+        records.append(Frame(timestamp_ms, seq, tag == RECORD_KEYFRAME, mask, values))
+    return records
+
+
+def format_square(square, first_file="a"):
+    return "%c%d" % (ord(first_file) + square % 8, square // 8 + 1)
+
+
+def format_record(record):
+    if isinstance(record, Frame):
+        if record.keyframe:
+            return "%u ms #%u keyframe\n%s" % (record.timestamp_ms, record.seq,
+                                               format_board(record.values))
+        changes = " ".join("%s:%d" % (format_square(sq, "A"), record.values[sq])
+                           for sq in range(NUM_SQUARES) if record.changed & (1 << sq))
+        return "%u ms #%u %s" % (record.timestamp_ms, record.seq, changes)
+
+    number = "%u%s" % (record.ply // 2 + 1, "..." if record.ply & 1 else ".")
+    if record.flags & MOVE_ILLEGAL:
+        move = "illegal position"
+    elif record.flags & MOVE_AMBIGUOUS:
+        move = "ambiguous position"
+    else:
+        move = format_square(record.square_from) + format_square(record.square_to)
+        if record.flags & MOVE_PROMOTION:
+            move += PIECES[record.promotion & PIECE_TYPE_MASK]
+        if record.flags & MOVE_CHECK:
+            move += "+"
+    return "%u ms %s %s" % (record.timestamp_ms, number, move)
+
+
+def format_board(values):
+    lines = []
+    for rank in range(7, -1, -1):
+        row = values[rank * 8:rank * 8 + 8]
+        lines.append("%d|" % (rank + 1) + "|".join("%4d" % v for v in row))
+    return "\n".join(lines)
+
+
+class Recording:
+    """Puts the chunks of a recording dump together, a dump starts over with chunk 0."""
+
+    def __init__(self):
+        self.format = None
+        self.count = None
+        self.chunks = {}
+
+    def chunk(self, fmt, index, count, data):
+        """Add one chunk. Returns the records once all chunks arrived, else None."""
+        if index == 0 or (fmt, count) != (self.format, self.count):
+            self.format = fmt
+            self.count = count
+            self.chunks = {}
+        if index >= count:
+            raise ValueError("chunk %d of %d" % (index, count))
+        self.chunks[index] = data
+        if len(self.chunks) < count:
+            return None
+
+        data = b"".join(self.chunks[i] for i in range(count))
+        self.chunks = {}
+        if fmt != RECORDER_FORMAT:
+            raise ValueError("unsupported recording format %d" % fmt)
+        return decode_records(data)
+
+
+class Decoder:
+    def __init__(self):
+        self.values = None
+        self.payload = None
+        self.seq = None
+        self.timestamp_ms = None
+        self.errors = 0
+        self.recording = Recording()
+        # Records of the last complete recording dump
+        self.records = None
+
+    def packet(self, encoded):
+        """Apply one COBS encoded packet (without delimiter). Returns True if the board changed."""
+        try:
+            packet = cobs_decode(encoded)
+        except ValueError:
+            self.errors += 1
+            return False
+
+        if len(packet) < 8 or crc16_ccitt(packet[:-2]) != struct.unpack_from("<H", packet, len(packet) - 2)[0]:
+            self.errors += 1
+            return False
+
+        if packet[0] == TYPE_RECORDING:
+            fmt, index, count = struct.unpack_from("<BHH", packet, 1)
+            try:
+                records = self.recording.chunk(fmt, index, count, packet[6:-2])
+            except ValueError:
+                self.errors += 1
+                return False
+            if records is not None:
+                self.records = records
+            return False
+
+        if len(packet) < 12:
+            self.errors += 1
+            return False
+
+        kind, payload, seq, timestamp_ms = struct.unpack_from("<BBII", packet, 0)
+        body = packet[10:-2]
+        if payload not in PAYLOADS:
+            self.errors += 1
+            return False
+
+        if kind == TYPE_FRAME:
+            if len(body) != 2 * NUM_SQUARES:
+                self.errors += 1
+                return False
+            self.values = list(struct.unpack("<64h", body))
+        elif kind == TYPE_DELTA:
+            if self.values is None or payload != self.payload:
+                # Wait for the next keyframe
+                return False
+            (mask,) = struct.unpack_from("<Q", body, 0)
+            squares = [sq for sq in range(NUM_SQUARES) if mask & (1 << sq)]
+            if len(body) != 8 + 2 * len(squares):
+                self.errors += 1
+                return False
+            for sq, value in zip(squares, struct.unpack_from("<%dh" % len(squares), body, 8)):
+                self.values[sq] = value
+        else:
+            self.errors += 1
+            return False
+
+        self.payload = payload
+        self.seq = seq
+        self.timestamp_ms = timestamp_ms
+        return True
+
+    def format(self):
+        header = "#%u %u ms (%s)" % (self.seq, self.timestamp_ms, PAYLOADS[self.payload])
+        return header + "\n" + format_board(self.values)
+
+
+def packets(stream, follow):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            if follow:
+                continue
+            return
+        buf += chunk
+        while True:
+            end = buf.find(0)
+            if end < 0:
+                break
+            if end > 0:
+                yield bytes(buf[:end])
+            del buf[:end + 1]
+
+
+def is_serial_port(path):
+    return path.startswith("/dev/") or path.upper().startswith("COM")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="serial port, capture file or - for stdin")
+    parser.add_argument("--start", help="shell command sent to the serial port to start streaming")
+    args = parser.parse_args()
+
+    port = None
+    if args.input == "-":
+        stream = sys.stdin.buffer
+    elif is_serial_port(args.input):
+        import serial
+
+        port = serial.Serial(args.input, timeout=1)
+        stream = port
+        if args.start:
+            port.write(args.start.encode() + b"\r\n")
+    else:
+        stream = open(args.input, "rb")
+
+    decoder = Decoder()
+    try:
+        for encoded in packets(stream, follow=port is not None):
+            if decoder.packet(encoded):
+                print(decoder.format(), flush=True)
+            elif decoder.records is not None:
+                for record in decoder.records:
+                    print(format_record(record))
+                print("%d records" % len(decoder.records), flush=True)
+                decoder.records = None
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if port is not None:
+            # Stops the stream and returns to the shell prompt
+            port.write(b"q")
+
+    if decoder.errors:
+        print("%d invalid packets" % decoder.errors, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,375 @@
+#!/usr/bin/env python3
+"""Tests of the host decoder in chessboard_stream.py.
+
+Packets are built the way app/src/chessboard_stream.c builds them, so a change of the wire format
+on either side fails here.
+
+    python3 -m unittest discover -s tools
+"""
+
+import io
+import os
+import struct
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import chessboard_stream as cs  # noqa: E402
+
+
+def cobs_encode(data):
+    """Same algorithm as cobs_encode() in chessboard_stream.c, including the delimiter."""
+    out = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte != 0:
+            out.append(byte)
+            code += 1
+        if byte == 0 or code == 0xFF:
+            out[code_index] = code
+            code = 1
+            code_index = len(out)
+            out.append(0)
+    out[code_index] = code
+    out.append(0)
+    return bytes(out)
+
+
+def with_crc(packet):
+    return packet + struct.pack("<H", cs.crc16_ccitt(packet))
+
+
+def frame_packet(seq, timestamp_ms, values, payload=cs.PAYLOAD_RAW):
+    header = struct.pack("<BBII", cs.TYPE_FRAME, payload, seq, timestamp_ms)
+    return cobs_encode(with_crc(header + struct.pack("<64h", *values)))
+
+
+def delta_packet(seq, timestamp_ms, changes, payload=cs.PAYLOAD_RAW):
+    mask = 0
+    for square in changes:
+        mask |= 1 << square
+    body = struct.pack("<Q", mask)
+    body += b"".join(struct.pack("<h", changes[sq]) for sq in sorted(changes))
+    header = struct.pack("<BBII", cs.TYPE_DELTA, payload, seq, timestamp_ms)
+    return cobs_encode(with_crc(header + body))
+
+
+UINT16_MAX = 0xFFFF
+
+
+class DeltaEncoder:
+    """Mirror of chessboard_stream_delta_init() and chessboard_stream_encode_delta(), with the
+    frame counter kept to 16 bits as in struct chessboard_stream_delta."""
+
+    def __init__(self, deadband, keyframe_interval=UINT16_MAX):
+        self.sent = [0] * cs.NUM_SQUARES
+        self.deadband = deadband
+        self.keyframe_interval = max(keyframe_interval, 1)
+        self.frames_since_keyframe = 0
+        self.keyframe_due = True
+
+    def encode(self, seq, timestamp_ms, values):
+        if not self.keyframe_due:
+            self.frames_since_keyframe = (self.frames_since_keyframe + 1) & UINT16_MAX
+            if self.frames_since_keyframe >= self.keyframe_interval:
+                self.keyframe_due = True
+        if self.keyframe_due:
+            self.frames_since_keyframe = 0
+            self.keyframe_due = False
+            self.sent = list(values)
+            return frame_packet(seq, timestamp_ms, values)
+
+        changes = {}
+        for square, value in enumerate(values):
+            if abs(value - self.sent[square]) > self.deadband:
+                changes[square] = value
+                self.sent[square] = value
+        if not changes:
+            return None
+        return delta_packet(seq, timestamp_ms, changes)
+
+
+def put_varint(value):
+    """Same as put_varint() in chessboard_recorder.c."""
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def put_zigzag(value):
+    return put_varint(((value << 1) ^ (value >> 31)) & 0xFFFFFFFF)
+
+
+def record(body):
+    return bytes([len(body)]) + body
+
+
+def keyframe_record(timestamp_ms, seq, values):
+    body = bytes([cs.RECORD_KEYFRAME]) + put_varint(timestamp_ms) + put_varint(seq)
+    return record(body + b"".join(put_zigzag(v) for v in values))
+
+
+def delta_record(dt_ms, dseq, deltas):
+    mask = 0
+    for square in deltas:
+        mask |= 1 << square
+    body = bytes([cs.RECORD_DELTA]) + put_varint(dt_ms) + put_varint(dseq) + put_varint(mask)
+    return record(body + b"".join(put_zigzag(deltas[sq]) for sq in sorted(deltas)))
+
+
+def move_record(dt_ms, ply, square_from, square_to, piece, captured=0, promotion=0, flags=0):
+    body = bytes([cs.RECORD_MOVE]) + put_varint(dt_ms) + put_varint(ply)
+    return record(body + bytes([square_from, square_to, piece, captured, promotion, flags]))
+
+
+def recording_packets(data, fmt=cs.RECORDER_FORMAT, chunk_size=240):
+    """Packets of 'board recorder dump binary', as chessboard_stream_encode_recording()."""
+    chunks = [data[i:i + chunk_size] for i in range(0, len(data), chunk_size)]
+    return [cobs_encode(with_crc(struct.pack("<BBHH", cs.TYPE_RECORDING, fmt, index,
+                                             len(chunks)) + chunk))
+            for index, chunk in enumerate(chunks)]
+
+
+def decode_all(data):
+    decoder = cs.Decoder()
+    updates = 0
+    for encoded in cs.packets(io.BytesIO(data), follow=False):
+        if decoder.packet(encoded):
+            updates += 1
+    return decoder, updates
+
+
+BOARD = [2048 + square for square in range(cs.NUM_SQUARES)]
+
+
+class StreamDecoderTest(unittest.TestCase):
+    def test_cobs_round_trip(self):
+        for data in (b"", b"\x00", b"\x00\x00", bytes(range(1, 255)), bytes(300), b"\x11\x00\x22"):
+            encoded = cobs_encode(data)
+            self.assertNotIn(0, encoded[:-1])
+            self.assertEqual(cs.cobs_decode(encoded[:-1]), data)
+
+    def test_crc_matches_zephyr(self):
+        # crc16_ccitt(0xFFFF, "123456789") in Zephyr, the reflected CCITT variant
+        self.assertEqual(cs.crc16_ccitt(b"123456789"), 0x6F91)
+
+    def test_keyframe(self):
+        decoder, updates = decode_all(frame_packet(7, 1234, BOARD))
+
+        self.assertEqual(updates, 1)
+        self.assertEqual(decoder.errors, 0)
+        self.assertEqual(decoder.seq, 7)
+        self.assertEqual(decoder.timestamp_ms, 1234)
+        self.assertEqual(decoder.values, BOARD)
+
+    def test_negative_values(self):
+        values = [-v for v in BOARD]
+        decoder, _ = decode_all(frame_packet(1, 0, values, cs.PAYLOAD_OFFSET))
+
+        self.assertEqual(decoder.values, values)
+        self.assertEqual(decoder.payload, cs.PAYLOAD_OFFSET)
+
+    def test_payload_unit(self):
+        decoder, _ = decode_all(frame_packet(1, 0, BOARD))
+        self.assertEqual(decoder.payload, cs.PAYLOAD_RAW)
+        self.assertIn("(raw counts)", decoder.format())
+
+        # Captures of firmware that still sent millivolts keep their unit
+        decoder, _ = decode_all(frame_packet(1, 0, BOARD, cs.PAYLOAD_MV))
+        self.assertIn("(mV)", decoder.format())
+
+    def test_unknown_payload(self):
+        decoder, updates = decode_all(frame_packet(1, 0, BOARD, 0x7F) + delta_packet(2, 5, {1: 1}))
+        self.assertEqual(updates, 0)
+        self.assertEqual(decoder.errors, 1)
+        self.assertIsNone(decoder.values)
+
+    def test_delta_with_mask(self):
+        changes = {0: 100, 27: -5, 63: 4095}
+        decoder, updates = decode_all(frame_packet(1, 10, BOARD) + delta_packet(2, 15, changes))
+
+        expected = list(BOARD)
+        for square, value in changes.items():
+            expected[square] = value
+        self.assertEqual(updates, 2)
+        self.assertEqual(decoder.seq, 2)
+        self.assertEqual(decoder.values, expected)
+
+    def test_delta_before_keyframe_is_ignored(self):
+        decoder, updates = decode_all(delta_packet(2, 15, {3: 1}) + frame_packet(3, 20, BOARD))
+
+        self.assertEqual(updates, 1)
+        self.assertEqual(decoder.errors, 0)
+        self.assertEqual(decoder.values, BOARD)
+
+    def test_deadband_suppression(self):
+        deadband = 4
+        encoder = DeltaEncoder(deadband)
+        stream = encoder.encode(1, 0, BOARD)
+        self.assertEqual(stream, frame_packet(1, 0, BOARD))
+
+        # Within the dead-band everywhere: nothing is sent
+        wobble = [v + (deadband if sq & 1 else -deadband) for sq, v in enumerate(BOARD)]
+        self.assertIsNone(encoder.encode(2, 5, wobble))
+
+        # One square beyond it: only that square is sent
+        moved = list(wobble)
+        moved[12] = BOARD[12] + 50
+        packet = encoder.encode(3, 10, moved)
+        self.assertIsNotNone(packet)
+        stream += packet
+
+        decoder, updates = decode_all(stream)
+        self.assertEqual(updates, 2)
+        self.assertEqual(decoder.values[12], moved[12])
+        for square in range(cs.NUM_SQUARES):
+            self.assertLessEqual(abs(decoder.values[square] - moved[square]), deadband)
+
+    def test_keyframe_interval(self):
+        for interval in (1, 3, UINT16_MAX):
+            encoder = DeltaEncoder(0, interval)
+            # Nothing changes, so only the keyframes are sent
+            keyframes = [seq for seq in range(2 * interval + 1)
+                         if encoder.encode(seq, seq, BOARD) is not None]
+
+            # The first frame is a keyframe, also at the largest interval
+            self.assertEqual(keyframes, [0, interval, 2 * interval], interval)
+
+    def test_crc_rejection(self):
+        good = frame_packet(1, 0, BOARD)
+        packet = bytearray(cs.cobs_decode(good[:-1]))
+        packet[20] ^= 0x01
+        corrupted = cobs_encode(bytes(packet))
+
+        decoder, updates = decode_all(corrupted)
+        self.assertEqual(updates, 0)
+        self.assertEqual(decoder.errors, 1)
+        self.assertIsNone(decoder.values)
+
+    def test_resync_after_garbage(self):
+        garbage = b"chess:~$ board stream delta\r\n\x05\x01\x02"
+        stream = garbage + b"\x00" + frame_packet(1, 0, BOARD) + b"\x13\x37" + b"\x00"
+        stream += delta_packet(2, 5, {8: 1})
+
+        decoder, updates = decode_all(stream)
+        self.assertEqual(updates, 2)
+        self.assertEqual(decoder.errors, 2)
+        self.assertEqual(decoder.seq, 2)
+        self.assertEqual(decoder.values[8], 1)
+
+    def test_truncated_delta(self):
+        packet = bytearray(cs.cobs_decode(delta_packet(2, 5, {1: 1, 2: 2})[:-1]))
+        truncated = with_crc(bytes(packet[:-4]))
+
+        decoder, updates = decode_all(frame_packet(1, 0, BOARD) + cobs_encode(truncated))
+        self.assertEqual(updates, 1)
+        self.assertEqual(decoder.errors, 1)
+
+
+E2 = 12
+E4 = 28
+
+
+class RecordingDecoderTest(unittest.TestCase):
+    def test_varint(self):
+        for value in (0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 2**32 - 1, 2**64 - 1):
+            encoded = put_varint(value)
+            self.assertEqual(cs.get_varint(encoded, 0), (value, len(encoded)))
+        for value in (0, -1, 1, -64, 64, -(2**31), 2**31 - 1):
+            encoded = put_zigzag(value)
+            self.assertEqual(cs.get_zigzag(encoded, 0), (value, len(encoded)))
+
+    def test_varint_errors(self):
+        with self.assertRaises(ValueError):
+            cs.get_varint(put_varint(0x4000)[:-1], 0)
+        with self.assertRaises(ValueError):
+            cs.get_varint(b"\x80" * 11, 0)
+
+    def test_records(self):
+        data = keyframe_record(1000, 50, BOARD)
+        data += delta_record(5, 1, {E2: -300, 63: 7})
+        data += move_record(3, 0, E2, E4, 1)
+        data += delta_record(2, 2, {E4: -290})
+
+        records = cs.decode_records(data)
+        self.assertEqual(len(records), 4)
+
+        keyframe, delta, move, last = records
+        self.assertTrue(keyframe.keyframe)
+        self.assertEqual((keyframe.timestamp_ms, keyframe.seq), (1000, 50))
+        self.assertEqual(keyframe.values, BOARD)
+
+        self.assertFalse(delta.keyframe)
+        self.assertEqual((delta.timestamp_ms, delta.seq), (1005, 51))
+        self.assertEqual(delta.changed, (1 << E2) | (1 << 63))
+        self.assertEqual(delta.values[E2], BOARD[E2] - 300)
+        self.assertEqual(delta.values[63], BOARD[63] + 7)
+        self.assertEqual(delta.values[0], BOARD[0])
+
+        # Times continue from the move, sequence numbers from the previous frame
+        self.assertEqual(move, cs.Move(1008, 0, E2, E4, 1, 0, 0, 0))
+        self.assertEqual((last.timestamp_ms, last.seq), (1010, 53))
+        self.assertEqual(last.values[E2], BOARD[E2] - 300)
+        self.assertEqual(last.values[E4], BOARD[E4] - 290)
+        self.assertEqual(cs.format_record(move), "1008 ms 1. e2e4")
+
+    def test_records_before_keyframe_are_skipped(self):
+        data = delta_record(5, 1, {3: 1}) + move_record(1, 4, E2, E4, 1)
+        data += keyframe_record(2000, 9, BOARD) + delta_record(1, 1, {3: 1})
+
+        records = cs.decode_records(data)
+        self.assertEqual([r.seq for r in records], [9, 10])
+        self.assertEqual(records[1].values[3], BOARD[3] + 1)
+
+    def test_move_flags(self):
+        promotion = cs.Move(0, 23, E2, 4, 9, 0, 13, cs.MOVE_PROMOTION | cs.MOVE_CHECK)
+        illegal = cs.Move(0, 4, 0xFF, 0xFF, 0, 0, 0, cs.MOVE_ILLEGAL)
+
+        self.assertEqual(cs.format_record(promotion), "0 ms 12... e2e1q+")
+        self.assertEqual(cs.format_record(illegal), "0 ms 3. illegal position")
+
+    def test_invalid_records(self):
+        for data in (b"\x00", keyframe_record(0, 0, BOARD)[:-1], record(b"\x07\x00"),
+                     record(move_record(0, 0, 1, 2, 3)[1:-1])):
+            with self.assertRaises(ValueError):
+                cs.decode_records(data)
+
+    def test_chunk_reassembly(self):
+        data = keyframe_record(100, 1, BOARD)
+        for i in range(40):
+            data += delta_record(5, 1, {i: i - 20})
+        packets = recording_packets(data)
+        self.assertGreater(len(packets), 1)
+
+        # Frames in between do not disturb the recording
+        decoder, updates = decode_all(frame_packet(1, 0, BOARD) + b"".join(packets))
+        self.assertEqual(updates, 1)
+        self.assertEqual(decoder.errors, 0)
+        self.assertEqual(len(decoder.records), 41)
+        self.assertEqual(decoder.records[-1].seq, 41)
+        self.assertEqual(decoder.records[-1].values[39], BOARD[39] + 19)
+
+    def test_incomplete_recording(self):
+        packets = recording_packets(keyframe_record(100, 1, [-1000] * cs.NUM_SQUARES) * 3)
+        self.assertGreater(len(packets), 1)
+
+        decoder, _ = decode_all(b"".join(packets[:-1]))
+        self.assertIsNone(decoder.records)
+
+        # A new dump starts over with its first chunk
+        decoder, _ = decode_all(b"".join(packets[:-1] + packets))
+        self.assertEqual(len(decoder.records), 3)
+
+    def test_unsupported_format(self):
+        decoder, _ = decode_all(b"".join(recording_packets(keyframe_record(0, 0, BOARD), fmt=1)))
+        self.assertIsNone(decoder.records)
+        self.assertEqual(decoder.errors, 1)
+
+
+if __name__ == "__main__":
+    unittest.main()